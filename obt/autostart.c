@@ -0,0 +1,321 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/autostart.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "obt/autostart.h"
+#include "obt/ddparse.h"
+#include "obt/paths.h"
+#include <glib.h>
+
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
+
+static const gchar *const phase_names[OBT_AUTOSTART_NUM_PHASES] = {
+    "Initialization",
+    "WindowManager",
+    "Panel",
+    "Desktop",
+    "Application"
+};
+
+static ObtAutostartPhase parse_phase(ObtDDFile *f)
+{
+    ObtAutostartPhase i;
+
+    for (i = 0; i < OBT_AUTOSTART_NUM_PHASES; ++i)
+        if (obt_ddfile_value_is(f, "X-GNOME-Autostart-Phase", phase_names[i]))
+            return i;
+    return OBT_AUTOSTART_PHASE_APPLICATION;
+}
+
+/*! Returns TRUE if any of the environments in the @key are in @envs */
+static gboolean in_environment(ObtDDFile *f, const gchar *key, gchar **envs,
+                               gboolean *present)
+{
+    gchar **list, **it, **e;
+    gulong n;
+    gboolean found = FALSE;
+
+    if (!(list = obt_ddfile_strings(f, key, FALSE, &n))) {
+        *present = FALSE;
+        return FALSE;
+    }
+    *present = TRUE;
+    for (it = list; *it && !found; ++it)
+        for (e = envs; e && *e && !found; ++e)
+            if (!strcmp(*it, *e)) found = TRUE;
+    g_strfreev(list);
+    return found;
+}
+
+static ObtAutostartEntry* load_entry(ObtPaths *p, const gchar *dir,
+                                     const gchar *name, gchar **envs)
+{
+    GSList paths = { NULL, NULL };
+    ObtDDFile *f;
+    ObtAutostartEntry *e;
+    gboolean only, not, has_only, has_not;
+
+    paths.data = (gchar*)dir;
+    if (!(f = obt_ddfile_open(name, &paths))) {
+        g_message("Invalid .desktop file: %s/%s", dir, name);
+        return NULL;
+    }
+
+    e = g_slice_new0(ObtAutostartEntry);
+    e->path = g_strdup(obt_ddfile_path(f));
+    e->name = obt_ddfile_string(f, "Name", TRUE);
+    if (!e->name) e->name = g_strdup(name);
+    e->exec = obt_ddfile_string(f, "Exec", FALSE);
+    e->wdir = obt_ddfile_string(f, "Path", FALSE);
+    e->try_exec = obt_ddfile_string(f, "TryExec", FALSE);
+    e->phase = parse_phase(f);
+    e->started = -1;
+
+    only = in_environment(f, "OnlyShowIn", envs, &has_only);
+    not = in_environment(f, "NotShowIn", envs, &has_not);
+
+    if (obt_ddfile_boolean(f, "Hidden", FALSE) ||
+        !obt_ddfile_boolean(f, "X-GNOME-Autostart-enabled", TRUE))
+        e->status = OBT_AUTOSTART_HIDDEN;
+    else if (!e->exec || !e->exec[0])
+        e->status = OBT_AUTOSTART_NO_EXEC;
+    else if (e->try_exec && !obt_paths_try_exec(p, e->try_exec))
+        e->status = OBT_AUTOSTART_TRY_EXEC;
+    else if (has_only && !only)
+        e->status = OBT_AUTOSTART_ONLY_SHOW_IN;
+    else if (!only && not)
+        e->status = OBT_AUTOSTART_NOT_SHOW_IN;
+    else
+        e->status = OBT_AUTOSTART_RUN;
+
+    obt_ddfile_close(f);
+    return e;
+}
+
+static gint entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const ObtAutostartEntry *ea = a, *eb = b;
+    return ea->phase - eb->phase;
+}
+
+GSList* obt_autostart_entries(ObtPaths *p, gchar **envs)
+{
+    GSList *it, *entries = NULL;
+    GHashTable *seen;
+
+    /* file names from the earlier directories hide the later ones, even when
+       they are not going to be run.  a file which can't be read doesn't
+       hide anything, so a broken override falls back to the later one */
+    seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    for (it = obt_paths_autostart_dirs(p); it; it = g_slist_next(it)) {
+        GDir *dir;
+        const gchar *n;
+
+        if (!(dir = g_dir_open(it->data, 0, NULL))) continue;
+        while ((n = g_dir_read_name(dir))) {
+            ObtAutostartEntry *e;
+
+            if (!g_str_has_suffix(n, ".desktop")) continue;
+            if (g_hash_table_lookup(seen, n)) continue;
+
+            if ((e = load_entry(p, it->data, n, envs))) {
+                g_hash_table_insert(seen, g_strdup(n), GINT_TO_POINTER(1));
+                entries = g_slist_prepend(entries, e);
+            }
+        }
+        g_dir_close(dir);
+    }
+    g_hash_table_destroy(seen);
+
+    /* g_slist_sort is stable, so within a phase they stay in the order
+       they were found */
+    return g_slist_sort(g_slist_reverse(entries), entry_cmp);
+}
+
+void obt_autostart_entries_free(GSList *entries)
+{
+    GSList *it;
+
+    for (it = entries; it; it = g_slist_next(it)) {
+        ObtAutostartEntry *e = it->data;
+        g_free(e->path);
+        g_free(e->name);
+        g_free(e->exec);
+        g_free(e->wdir);
+        g_free(e->try_exec);
+        g_slice_free(ObtAutostartEntry, e);
+    }
+    g_slist_free(entries);
+}
+
+/*! Remove the field codes from an Exec key, none of them are used when
+  autostarting */
+static gchar* strip_field_codes(const gchar *exec)
+{
+    GString *s;
+    const gchar *c;
+
+    s = g_string_sized_new(strlen(exec));
+    for (c = exec; *c; ++c) {
+        if (*c == '%') {
+            if (*(c+1) == '%') g_string_append_c(s, '%');
+            if (*(c+1)) ++c;
+        }
+        else
+            g_string_append_c(s, *c);
+    }
+    return g_string_free(s, FALSE);
+}
+
+static gdouble elapsed(const GTimeVal *start)
+{
+    GTimeVal now;
+
+    g_get_current_time(&now);
+    return (now.tv_sec - start->tv_sec) +
+        (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+static gboolean start_entry(ObtAutostartEntry *e, gboolean wait,
+                            const GTimeVal *start)
+{
+    gchar *cmd, *argv[4];
+    GError *err = NULL;
+    gboolean ok;
+
+    cmd = strip_field_codes(e->exec);
+
+    /* the commands are run through the shell as they always have been, and
+       exec lets the pid be the command's own for waiting on it */
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = g_strconcat("exec ", cmd, NULL);
+    argv[3] = NULL;
+    ok = g_spawn_async(e->wdir && e->wdir[0] ? e->wdir : NULL, argv, NULL,
+                       wait ? G_SPAWN_DO_NOT_REAP_CHILD : 0,
+                       NULL, NULL, wait ? &e->pid : NULL, &err);
+    if (!ok) {
+        g_message("Failed to run %s from %s: %s", cmd, e->path,
+                  err->message);
+        g_error_free(err);
+    }
+    else
+        e->started = elapsed(start);
+    g_free(argv[2]);
+    g_free(cmd);
+    return ok;
+}
+
+/*! The commands being waited for in the Initialization phase.  This outlives
+  obt_autostart_run() if they don't exit before the timeout. */
+typedef struct {
+    GMainLoop *loop;
+    guint running;
+} PhaseWait;
+
+static void child_exited(GPid pid, gint status, gpointer data)
+{
+    PhaseWait *w = data;
+
+    g_spawn_close_pid(pid);
+    if (--w->running == 0) {
+        if (w->loop)
+            g_main_loop_quit(w->loop);
+        else
+            g_slice_free(PhaseWait, w);
+    }
+}
+
+static gboolean phase_timeout(gpointer data)
+{
+    PhaseWait *w = data;
+
+    g_main_loop_quit(w->loop);
+    return FALSE; /* don't repeat */
+}
+
+static void wait_phase(PhaseWait *w, guint timeout)
+{
+    guint id;
+
+    w->loop = g_main_loop_new(NULL, FALSE);
+    id = g_timeout_add(timeout, phase_timeout, w);
+    g_main_loop_run(w->loop);
+    g_source_remove(id);
+    g_main_loop_unref(w->loop);
+    w->loop = NULL;
+
+    if (w->running == 0)
+        g_slice_free(PhaseWait, w);
+}
+
+guint obt_autostart_run(GSList *entries, gboolean ordered, guint timeout)
+{
+    GSList *it;
+    GTimeVal start;
+    PhaseWait *w;
+    guint started = 0;
+
+    g_get_current_time(&start);
+    w = g_slice_new0(PhaseWait);
+
+    for (it = entries; it; it = g_slist_next(it)) {
+        ObtAutostartEntry *e = it->data;
+        gboolean wait;
+
+        if (e->status != OBT_AUTOSTART_RUN) continue;
+
+        /* entries are sorted by phase, so wait for the Initialization
+           phase before anything after it */
+        if (w && w->running &&
+            e->phase != OBT_AUTOSTART_PHASE_INITIALIZATION)
+        {
+            wait_phase(w, timeout);
+            w = NULL;
+        }
+
+        wait = w && ordered && e->phase == OBT_AUTOSTART_PHASE_INITIALIZATION;
+        if (start_entry(e, wait, &start)) {
+            ++started;
+            if (wait) {
+                ++w->running;
+                g_child_watch_add(e->pid, child_exited, w);
+            }
+        }
+    }
+    /* nothing is waiting on it when no other phase is started */
+    if (w && w->running == 0)
+        g_slice_free(PhaseWait, w);
+    return started;
+}
+
+const gchar* obt_autostart_status_string(ObtAutostartStatus s)
+{
+    switch (s) {
+    case OBT_AUTOSTART_RUN: return "Will be run";
+    case OBT_AUTOSTART_HIDDEN: return "Excluded by: Hidden";
+    case OBT_AUTOSTART_NO_EXEC: return "Excluded by: Missing Exec field";
+    case OBT_AUTOSTART_TRY_EXEC: return "Excluded by: TryExec";
+    case OBT_AUTOSTART_ONLY_SHOW_IN: return "Excluded by: OnlyShowIn";
+    case OBT_AUTOSTART_NOT_SHOW_IN: return "Excluded by: NotShowIn";
+    }
+    g_assert_not_reached();
+    return NULL;
+}
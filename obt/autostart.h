@@ -0,0 +1,88 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/autostart.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __obt_autostart_h
+#define __obt_autostart_h
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+struct _ObtPaths;
+
+/*! The phases from the X-GNOME-Autostart-Phase key, in the order that they
+  are started */
+typedef enum {
+    OBT_AUTOSTART_PHASE_INITIALIZATION,
+    OBT_AUTOSTART_PHASE_WINDOW_MANAGER,
+    OBT_AUTOSTART_PHASE_PANEL,
+    OBT_AUTOSTART_PHASE_DESKTOP,
+    OBT_AUTOSTART_PHASE_APPLICATION, /*!< The default phase */
+    OBT_AUTOSTART_NUM_PHASES
+} ObtAutostartPhase;
+
+/*! Why an autostart entry will or will not be run */
+typedef enum {
+    OBT_AUTOSTART_RUN,
+    OBT_AUTOSTART_HIDDEN, /*!< Hidden, or X-GNOME-Autostart-enabled=false */
+    OBT_AUTOSTART_NO_EXEC, /*!< The Exec key is missing */
+    OBT_AUTOSTART_TRY_EXEC, /*!< The TryExec program was not found */
+    OBT_AUTOSTART_ONLY_SHOW_IN, /*!< Not in any of the OnlyShowIn
+                                  environments */
+    OBT_AUTOSTART_NOT_SHOW_IN /*!< In one of the NotShowIn environments */
+} ObtAutostartStatus;
+
+typedef struct _ObtAutostartEntry {
+    gchar *path; /*!< The .desktop file */
+    gchar *name;
+    gchar *exec; /*!< The command to run, or NULL */
+    gchar *wdir; /*!< The directory to run the command in, or NULL */
+    gchar *try_exec;
+    ObtAutostartPhase phase;
+    ObtAutostartStatus status;
+    GPid pid; /*!< Set when the entry is started, if it was waited for */
+    /*! The time it was started, in seconds after obt_autostart_run() was
+      called, or -1 if it was not started */
+    gdouble started;
+} ObtAutostartEntry;
+
+/*! Find the .desktop files in the autostart directories.  A file in one
+  directory hides the files with the same name in the directories after it,
+  unless it can't be parsed.
+  @envs The environments being started, such as OPENBOX or GNOME.  These are
+    matched against each file's OnlyShowIn and NotShowIn keys.
+  Returns a list of ObtAutostartEntry, including the ones which will not be
+  run, ordered by their phase.
+*/
+GSList* obt_autostart_entries(struct _ObtPaths *p, gchar **envs);
+void obt_autostart_entries_free(GSList *entries);
+
+/*! Start all of the entries which should run.  The entries do not wait for
+  each other, unless @ordered is TRUE.  Then the commands in the
+  Initialization phase must exit, or @timeout milliseconds pass, before the
+  next phases are started.
+  Returns the number of entries started.
+*/
+guint obt_autostart_run(GSList *entries, gboolean ordered, guint timeout);
+
+/*! A description of an entry's status, for showing to users */
+const gchar* obt_autostart_status_string(ObtAutostartStatus s);
+
+G_END_DECLS
+
+#endif
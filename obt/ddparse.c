@@ -24,6 +24,21 @@
 #ifdef HAVE_STDIO_H
 #include <stdio.h>
 #endif
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 typedef struct _ObtDDParse ObtDDParse;
 
@@ -53,6 +68,26 @@ struct _ObtDDParse {
     GHashTable *group_hash;
 };
 
+/*! A key and its value in the [Desktop Entry] group, pointing into the
+  file's contents */
+typedef struct _ObtDDEntry {
+    const gchar *key;
+    gsize keylen;
+    const gchar *val;
+    gsize vallen;
+    gulong lineno;
+} ObtDDEntry;
+
+struct _ObtDDFile {
+    gchar *path;
+    const gchar *data;
+    gsize size;
+    gboolean mapped;
+    /*! The ObtDDEntry for each key in the [Desktop Entry] group, in the order
+      they appear in the file */
+    GArray *entries;
+};
+
 struct _ObtDDParseGroup {
     gchar *name;
     gboolean seen;
@@ -120,11 +155,17 @@ static void parse_group_free(ObtDDParseGroup *g)
 
 /*! Reads an input string, strips out invalid stuff, and parses
     backslash-stuff.
+    @inlen The length of the input, which does not have to be null
+      terminated.
+    @stop Returns where the input string ended, at a semicolon if
+      @semicolonterminate is TRUE, or at the end of the input.
  */
 static gchar* parse_value_string(const gchar *in,
+                                 gsize inlen,
                                  gboolean locale,
                                  gboolean semicolonterminate,
                                  gulong *len,
+                                 const gchar **stop,
                                  const ObtDDParse *const parse,
                                  gboolean *error)
 {
@@ -133,19 +174,20 @@ static gchar* parse_value_string(const gchar *in,
     gchar *out, *o;
     const gchar *end, *i;
 
+    g_return_val_if_fail(in != NULL, NULL);
+
     /* find the end/size of the string */
     backslash = FALSE;
-    for (end = in; *end; ++end) {
+    for (end = in; end < in + inlen && *end; ++end) {
         if (semicolonterminate) {
             if (backslash) backslash = FALSE;
             else if (*end == '\\') backslash = TRUE;
             else if (*end == ';') break;
         }
     }
+    if (stop) *stop = end;
     bytes = end - in;
 
-    g_return_val_if_fail(in != NULL, NULL);
-
     if (locale && !g_utf8_validate(in, bytes, &end)) {
         parse_error("Invalid bytes in localestring", parse, error);
         bytes = end - in;
@@ -202,25 +244,27 @@ static gchar* parse_value_string(const gchar *in,
     backslash-stuff.
  */
 static gchar** parse_value_strings(const gchar *in,
+                                   gsize inlen,
                                    gboolean locale,
                                    gulong *nstrings,
                                    const ObtDDParse *const parse,
                                    gboolean *error)
 {
     gchar **out;
-    const gchar *i;
+    const gchar *i, *end;
 
     out = g_new(gchar*, 1);
     out[0] = NULL;
     *nstrings = 0;
 
     i = in;
+    end = in + inlen;
     while (TRUE) {
         gchar *a;
         gulong len;
 
-        a = parse_value_string(i, locale, TRUE, &len, parse, error);
-        i += len;
+        a = parse_value_string(i, end - i, locale, TRUE, &len, &i,
+                               parse, error);
 
         if (len) {
             (*nstrings)++;
@@ -228,8 +272,10 @@ static gchar** parse_value_strings(const gchar *in,
             out[*nstrings-1] = a;
             out[*nstrings] = NULL;
         }
+        else
+            g_free(a);
 
-        if (!*i) break; /* no more strings */
+        if (i >= end || !*i) break; /* no more strings */
         ++i;
     }
     return out;
@@ -318,89 +364,28 @@ static gfloat parse_value_numeric(const gchar *in,
     return out;
 }
 
-static gboolean parse_file_line(FILE *f, gchar **buf,
-                                gulong *size, gulong *read,
-                                ObtDDParse *parse, gboolean *error)
+/*! Find the next line in the file's contents.  The newline is not included
+  in the line. */
+static gboolean next_line(const gchar **pos, const gchar *end,
+                          const gchar **line, gsize *len)
 {
-    const gulong BUFMUL = 80;
-    size_t ret;
-    gulong i, null;
-
-    if (*size == 0) {
-        g_assert(*read == 0);
-        *size = BUFMUL;
-        *buf = g_new(char, *size);
-    }
-
-    /* remove everything up to a null zero already in the buffer and shift
-       the rest to the front */
-    null = *size;
-    for (i = 0; i < *read; ++i) {
-        if (null < *size)
-            (*buf)[i-null-1] = (*buf)[i];
-        else if ((*buf)[i] == '\0')
-            null = i;
-    }
-    if (null < *size)
-        *read -= null + 1;
-
-    /* is there already a newline in the buffer? */
-    for (i = 0; i < *read; ++i)
-        if ((*buf)[i] == '\n') {
-            /* turn it into a null zero and done */
-            (*buf)[i] = '\0';
-            return TRUE;
-        }
-
-    /* we need to read some more to find a newline */
-    while (TRUE) {
-        gulong eol;
-        gchar *newread;
+    const gchar *eol;
 
-        newread = *buf + *read;
-        ret = fread(newread, sizeof(char), *size-*read, f);
-        if (ret < *size - *read && !feof(f)) {
-            parse_error("Error reading", parse, error);
-            return FALSE;
-        }
-        *read += ret;
-
-        /* strip out null zeros in the input and look for an endofline */
-        null = 0;
-        eol = *size;
-        for (i = newread-*buf; i < *read; ++i) {
-            if (null > 0)
-                (*buf)[i] = (*buf)[i+null];
-            if ((*buf)[i] == '\0') {
-                ++null;
-                --(*read);
-                --i; /* try again */
-            }
-            else if ((*buf)[i] == '\n' && eol == *size) {
-                eol = i;
-                /* turn it into a null zero */
-                (*buf)[i] = '\0';
-            }
-        }
+    if (*pos >= end) return FALSE;
 
-        if (eol != *size)
-            /* found an endofline, done */
-            break;
-        else if (feof(f) && *read < *size) {
-            /* found the endoffile, done (if there is space) */
-            if (*read > 0) {
-                /* stick a null zero on if there is test on the last line */
-                (*buf)[(*read)++] = '\0';
-            }
-            break;
-        }
-        else {
-            /* read more */
-            size += BUFMUL;
-            *buf = g_renew(char, *buf, *size);
-        }
+    *line = *pos;
+    if ((eol = memchr(*pos, '\n', end - *pos))) {
+        *len = eol - *pos;
+        *pos = eol + 1;
+    }
+    else {
+        *len = end - *pos;
+        *pos = end;
     }
-    return *read > 0;
+    /* files written on other systems can have \r\n line endings */
+    if (*len && (*line)[*len-1] == '\r')
+        --*len;
+    return TRUE;
 }
 
 static void parse_group(const gchar *buf, gulong len,
@@ -446,7 +431,6 @@ static void parse_group(const gchar *buf, gulong len,
 
         g->seen = TRUE;
         parse->group = g;
-        g_print("Found group %s\n", g->name);
     }
 }
 
@@ -503,36 +487,37 @@ static void parse_key_value(const gchar *buf, gulong len,
         g_free(key);
         return;
     }
-    g_print("Found key/value %s=%s.\n", key, buf+valstart);
-    if (parse->group->value_func)
-        if (!parse->group->value_func(key, buf+valstart, parse, error)) {
+    if (parse->group->value_func) {
+        gchar *val = g_strndup(buf+valstart, len-valstart);
+        if (!parse->group->value_func(key, val, parse, error)) {
             parse_error("Unknown key", parse, error);
             g_free(key);
         }
+        g_free(val);
+    }
 }
 
-static gboolean parse_file(FILE *f, ObtDDParse *parse)
+static gboolean parse_file(const gchar *data, gsize size, ObtDDParse *parse)
 {
-    gchar *buf = NULL;
-    gulong bytes = 0, read = 0;
+    const gchar *pos, *line;
+    gsize len;
     gboolean error = FALSE;
 
-    while (!error && parse_file_line(f, &buf, &bytes, &read, parse, &error)) {
-        gulong len = strlen(buf);
-        if (buf[0] == '#' || buf[0] == '\0')
+    pos = data;
+    while (!error && next_line(&pos, data + size, &line, &len)) {
+        if (len == 0 || line[0] == '#')
             ; /* ignore comment lines */
-        else if (buf[0] == '[' && buf[len-1] == ']')
-            parse_group(buf, len, parse, &error);
+        else if (line[0] == '[' && line[len-1] == ']')
+            parse_group(line, len, parse, &error);
         else if (!parse->group)
             /* just ignore keys outside of groups */
             parse_error("Key found before group", parse, NULL);
         else
             /* ignore errors in key-value pairs and continue */
-            parse_key_value(buf, len, parse, NULL);
+            parse_key_value(line, len, parse, NULL);
         ++parse->lineno;
     }
 
-    if (buf) g_free(buf);
     return !error;
 }
 
@@ -641,8 +626,8 @@ static gboolean parse_desktop_entry_value(gchar *key, const gchar *val,
         gboolean percent;
         gboolean found;
 
-        v.value.string = parse_value_string(val, FALSE, FALSE, NULL,
-                                            parse, error);
+        v.value.string = parse_value_string(val, strlen(val), FALSE, FALSE,
+                                            NULL, NULL, parse, error);
         g_assert(v.value.string);
 
         /* an exec string can only contain one of the file/url-opening %'s */
@@ -691,23 +676,25 @@ static gboolean parse_desktop_entry_value(gchar *key, const gchar *val,
         break;
     }
     case OBT_DDPARSE_STRING:
-        v.value.string = parse_value_string(val, FALSE, FALSE, NULL,
-                                            parse, error);
+        v.value.string = parse_value_string(val, strlen(val), FALSE, FALSE,
+                                            NULL, NULL, parse, error);
         g_assert(v.value.string);
         break;
     case OBT_DDPARSE_LOCALESTRING:
-        v.value.string = parse_value_string(val, TRUE, FALSE, NULL,
-                                            parse, error);
+        v.value.string = parse_value_string(val, strlen(val), TRUE, FALSE,
+                                            NULL, NULL, parse, error);
         g_assert(v.value.string);
         break;
     case OBT_DDPARSE_STRINGS:
-        v.value.strings.a = parse_value_strings(val, FALSE, &v.value.strings.n,
+        v.value.strings.a = parse_value_strings(val, strlen(val), FALSE,
+                                                &v.value.strings.n,
                                                 parse, error);
         g_assert(v.value.strings.a);
         g_assert(v.value.strings.n);
         break;
     case OBT_DDPARSE_LOCALESTRINGS:
-        v.value.strings.a = parse_value_strings(val, TRUE, &v.value.strings.n,
+        v.value.strings.a = parse_value_strings(val, strlen(val), TRUE,
+                                                &v.value.strings.n,
                                                 parse, error);
         g_assert(v.value.strings.a);
         g_assert(v.value.strings.n);
@@ -747,12 +734,51 @@ static gboolean parse_desktop_entry_value(gchar *key, const gchar *val,
     return TRUE;
 }
 
+/*! Map the file into memory, or read it if it can't be mapped */
+static gboolean map_file(const gchar *path, const gchar **data, gsize *size,
+                         gboolean *mapped)
+{
+#ifdef HAVE_SYS_MMAN_H
+    struct stat st;
+    gint fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return FALSE;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        gpointer m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            close(fd);
+            *data = m;
+            *size = st.st_size;
+            *mapped = TRUE;
+            return TRUE;
+        }
+    }
+    close(fd);
+#endif
+    *mapped = FALSE;
+    return g_file_get_contents(path, (gchar**)data, size, NULL);
+}
+
+static void unmap_file(const gchar *data, gsize size, gboolean mapped)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (mapped) {
+        munmap((gpointer)data, size);
+        return;
+    }
+#endif
+    g_free((gchar*)data);
+}
+
 GHashTable* obt_ddparse_file(const gchar *name, GSList *paths)
 {
     ObtDDParse parse;
     ObtDDParseGroup *desktop_entry;
     GSList *it;
-    FILE *f;
+    const gchar *data;
+    gsize size;
+    gboolean mapped;
     gboolean success;
 
     parse.filename = NULL;
@@ -771,11 +797,11 @@ GHashTable* obt_ddparse_file(const gchar *name, GSList *paths)
     success = FALSE;
     for (it = paths; it && !success; it = g_slist_next(it)) {
         gchar *path = g_strdup_printf("%s/%s", (char*)it->data, name);
-        if ((f = fopen(path, "r"))) {
+        if (map_file(path, &data, &size, &mapped)) {
             parse.filename = path;
             parse.lineno = 1;
             parse.flags = 0;
-            if ((success = parse_file(f, &parse))) {
+            if ((success = parse_file(data, size, &parse))) {
                 /* check that required keys exist */
 
                 if (!(parse.flags & DE_TYPE)) {
@@ -799,7 +825,7 @@ GHashTable* obt_ddparse_file(const gchar *name, GSList *paths)
                     success = FALSE;
                 }
             }
-            fclose(f);
+            unmap_file(data, size, mapped);
         }
         g_free(path);
     }
@@ -814,3 +840,218 @@ GHashTable* obt_ddparse_group_keys(ObtDDParseGroup *g)
 {
     return g->key_hash;
 }
+
+static gboolean is_key_char(gchar c)
+{
+    return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+            (c >= '0' && c <= '9') || c == '-');
+}
+
+/*! Find the key and value on a line, without copying them.  Keys with a
+  locale, like Name[fr], are found with the locale as part of the key. */
+static gboolean tokenize_key_value(const gchar *buf, gsize len,
+                                   ObtDDEntry *e)
+{
+    gsize i;
+
+    for (i = 0; i < len && is_key_char(buf[i]); ++i);
+    if (i == 0)
+        return FALSE;
+    if (i < len && buf[i] == '[') {
+        while (i < len && buf[i] != ']') ++i;
+        if (i == len) return FALSE;
+        ++i;
+    }
+    e->key = buf;
+    e->keylen = i;
+
+    while (i < len && buf[i] == ' ') ++i;
+    if (i == len || buf[i] != '=')
+        return FALSE;
+    ++i;
+    while (i < len && buf[i] == ' ') ++i;
+
+    e->val = buf + i;
+    e->vallen = len - i;
+    return e->vallen > 0;
+}
+
+/*! Make one pass over the file's contents, and remember where each key in
+  the [Desktop Entry] group is */
+static gboolean tokenize(ObtDDFile *f)
+{
+    const gchar *pos, *line;
+    gsize len;
+    gulong lineno;
+    gboolean seen_group, in_group;
+    ObtDDParse parse;
+
+    parse.filename = f->path;
+
+    seen_group = in_group = FALSE;
+    pos = f->data;
+    for (lineno = 1; next_line(&pos, f->data + f->size, &line, &len);
+         ++lineno)
+    {
+        if (len == 0 || line[0] == '#')
+            continue; /* ignore comment lines */
+        else if (line[0] == '[' && line[len-1] == ']') {
+            in_group = (len == 15 && !memcmp(line, "[Desktop Entry]", 15));
+            if (!seen_group && !in_group) {
+                parse.lineno = lineno;
+                parse_error("Incorrect group found, "
+                            "expected [Desktop Entry]", &parse, NULL);
+                return FALSE;
+            }
+            seen_group = TRUE;
+        }
+        else if (in_group) {
+            ObtDDEntry e;
+
+            if (tokenize_key_value(line, len, &e)) {
+                e.lineno = lineno;
+                g_array_append_val(f->entries, e);
+            }
+            else {
+                parse.lineno = lineno;
+                parse_error("Invalid key/value line", &parse, NULL);
+            }
+        }
+    }
+    return seen_group;
+}
+
+ObtDDFile* obt_ddfile_open(const gchar *name, GSList *paths)
+{
+    ObtDDFile *f;
+    GSList *it;
+
+    f = g_slice_new0(ObtDDFile);
+    for (it = paths; it; it = g_slist_next(it)) {
+        f->path = g_strdup_printf("%s/%s", (char*)it->data, name);
+        if (map_file(f->path, &f->data, &f->size, &f->mapped))
+            break;
+        g_free(f->path);
+        f->path = NULL;
+    }
+    if (!f->path) {
+        g_slice_free(ObtDDFile, f);
+        return NULL;
+    }
+
+    /* most .desktop files have less than this many keys without a locale */
+    f->entries = g_array_sized_new(FALSE, FALSE, sizeof(ObtDDEntry), 32);
+    if (!tokenize(f)) {
+        obt_ddfile_close(f);
+        return NULL;
+    }
+    return f;
+}
+
+void obt_ddfile_close(ObtDDFile *f)
+{
+    if (f) {
+        unmap_file(f->data, f->size, f->mapped);
+        g_array_free(f->entries, TRUE);
+        g_free(f->path);
+        g_slice_free(ObtDDFile, f);
+    }
+}
+
+const gchar* obt_ddfile_path(ObtDDFile *f)
+{
+    return f->path;
+}
+
+static const ObtDDEntry* find_entry(ObtDDFile *f, const gchar *key)
+{
+    const gsize keylen = strlen(key);
+    guint i;
+
+    /* the first one wins if a key appears more than once */
+    for (i = 0; i < f->entries->len; ++i) {
+        const ObtDDEntry *e = &g_array_index(f->entries, ObtDDEntry, i);
+        if (e->keylen == keylen && e->key[0] == key[0] &&
+            !memcmp(e->key, key, keylen))
+            return e;
+    }
+    return NULL;
+}
+
+gboolean obt_ddfile_has_key(ObtDDFile *f, const gchar *key)
+{
+    return find_entry(f, key) != NULL;
+}
+
+gboolean obt_ddfile_value_is(ObtDDFile *f, const gchar *key,
+                             const gchar *value)
+{
+    const ObtDDEntry *e;
+
+    if (!(e = find_entry(f, key))) return FALSE;
+    return e->vallen == strlen(value) && !memcmp(e->val, value, e->vallen);
+}
+
+gchar* obt_ddfile_string(ObtDDFile *f, const gchar *key, gboolean locale)
+{
+    const ObtDDEntry *e;
+    ObtDDParse parse;
+
+    if (!(e = find_entry(f, key))) return NULL;
+
+    parse.filename = f->path;
+    parse.lineno = e->lineno;
+    return parse_value_string(e->val, e->vallen, locale, FALSE, NULL, NULL,
+                              &parse, NULL);
+}
+
+gchar** obt_ddfile_strings(ObtDDFile *f, const gchar *key, gboolean locale,
+                           gulong *n)
+{
+    const ObtDDEntry *e;
+    ObtDDParse parse;
+
+    if (!(e = find_entry(f, key))) {
+        *n = 0;
+        return NULL;
+    }
+
+    parse.filename = f->path;
+    parse.lineno = e->lineno;
+    return parse_value_strings(e->val, e->vallen, locale, n, &parse, NULL);
+}
+
+gboolean obt_ddfile_boolean(ObtDDFile *f, const gchar *key, gboolean def)
+{
+    const ObtDDEntry *e;
+    ObtDDParse parse;
+
+    if (!(e = find_entry(f, key))) return def;
+
+    if (e->vallen == 4 && !memcmp(e->val, "true", 4))
+        return TRUE;
+    if (e->vallen == 5 && !memcmp(e->val, "false", 5))
+        return FALSE;
+
+    parse.filename = f->path;
+    parse.lineno = e->lineno;
+    parse_error("Invalid boolean value", &parse, NULL);
+    return def;
+}
+
+guint obt_ddfile_environments(ObtDDFile *f, const gchar *key)
+{
+    const ObtDDEntry *e;
+    gchar *val;
+    guint mask;
+    ObtDDParse parse;
+
+    if (!(e = find_entry(f, key))) return 0;
+
+    parse.filename = f->path;
+    parse.lineno = e->lineno;
+    val = g_strndup(e->val, e->vallen);
+    mask = parse_value_environments(val, &parse, NULL);
+    g_free(val);
+    return mask;
+}
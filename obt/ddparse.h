@@ -19,6 +19,7 @@
 #include <glib.h>
 
 typedef struct _ObtDDParseGroup ObtDDParseGroup;
+typedef struct _ObtDDFile ObtDDFile;
 
 typedef enum {
     OBT_DDPARSE_EXEC,
@@ -55,3 +56,27 @@ GHashTable* obt_ddparse_file(const gchar *name, GSList *paths);
 /* Returns a hash table where the keys are "keys" in the .desktop file,
    and the values are "values" in the .desktop file, for the group @g. */
 GHashTable* obt_ddparse_group_keys(ObtDDParseGroup *g);
+
+/*! Map a .desktop file into memory, and find the keys in its [Desktop Entry]
+  group, without copying anything out of it.  The first file named @name in
+  any of the @paths is used.  Values are only parsed when they are asked for.
+  Returns NULL if the file is not found or is not a .desktop file. */
+ObtDDFile* obt_ddfile_open(const gchar *name, GSList *paths);
+void obt_ddfile_close(ObtDDFile *f);
+
+/*! The path of the file which was opened */
+const gchar* obt_ddfile_path(ObtDDFile *f);
+
+gboolean obt_ddfile_has_key(ObtDDFile *f, const gchar *key);
+/*! Returns TRUE if the @key's value is exactly @value, without parsing it */
+gboolean obt_ddfile_value_is(ObtDDFile *f, const gchar *key,
+                             const gchar *value);
+/*! Returns a newly allocated string, or NULL if the key is not present */
+gchar* obt_ddfile_string(ObtDDFile *f, const gchar *key, gboolean locale);
+/*! Returns a newly allocated NULL-terminated array of strings, or NULL if the
+  key is not present */
+gchar** obt_ddfile_strings(ObtDDFile *f, const gchar *key, gboolean locale,
+                           gulong *n);
+gboolean obt_ddfile_boolean(ObtDDFile *f, const gchar *key, gboolean def);
+/*! Returns a mask of flags from ObtLinkEnvFlags */
+guint obt_ddfile_environments(ObtDDFile *f, const gchar *key);
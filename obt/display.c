@@ -38,8 +38,6 @@ extern void xqueue_destroy(void);
 
 Display* obt_display = NULL;
 
-gboolean obt_display_error_occured = FALSE;
-
 gboolean obt_display_extension_xkb       = FALSE;
 gint     obt_display_extension_xkb_basep;
 gboolean obt_display_extension_shape     = FALSE;
@@ -51,9 +49,24 @@ gint     obt_display_extension_randr_basep;
 gboolean obt_display_extension_sync      = FALSE;
 gint     obt_display_extension_sync_basep;
 
+typedef struct _ObtErrorRange {
+    gulong start;   /*!< The serial of the first request in the range */
+    gulong end;     /*!< The serial of the last request in the range */
+    gboolean error; /*!< An error arrived for a request in the range */
+} ObtErrorRange;
+
+/*! Compares two request serials, allowing for them to wrap around */
+#define SERIAL_AFTER_EQ(a, b) ((glong)((a) - (b)) >= 0)
+
 static gint xerror_handler(Display *d, XErrorEvent *e);
 
 static gboolean xerror_ignore = FALSE;
+/*! The ranges of requests for which errors are being ignored.  A range is
+  kept until the server has processed all of its requests, as its errors
+  can arrive any time before then. */
+static GSList *xerror_ranges = NULL;
+/*! The range being recorded, or the one most recently recorded */
+static ObtErrorRange *xerror_last = NULL;
 
 gboolean obt_display_open(const char *display_name)
 {
@@ -129,20 +142,63 @@ gboolean obt_display_open(const char *display_name)
 
 void obt_display_close(void)
 {
+    while (xerror_ranges) {
+        g_slice_free(ObtErrorRange, xerror_ranges->data);
+        xerror_ranges = g_slist_delete_link(xerror_ranges, xerror_ranges);
+    }
+    xerror_last = NULL;
+
     obt_keyboard_shutdown();
+    obt_prop_cache_shutdown();
     if (obt_display) {
         xqueue_destroy();
         XCloseDisplay(obt_display);
     }
 }
 
+/*! Find the ignored range which the request with the given serial belongs
+  to, if any */
+static ObtErrorRange* find_range(gulong serial)
+{
+    GSList *it;
+
+    for (it = xerror_ranges; it; it = g_slist_next(it)) {
+        ObtErrorRange *r = it->data;
+        const gboolean open = (r == xerror_last && xerror_ignore);
+
+        if (SERIAL_AFTER_EQ(serial, r->start) &&
+            (open || SERIAL_AFTER_EQ(r->end, serial)))
+            return r;
+    }
+    return NULL;
+}
+
+/*! Forget the ranges whose requests have all been processed, since no more
+  errors can arrive for them */
+static void prune_ranges(void)
+{
+    const gulong done = LastKnownRequestProcessed(obt_display);
+    GSList *it, *next;
+
+    for (it = xerror_ranges; it; it = next) {
+        ObtErrorRange *r = it->data;
+
+        next = g_slist_next(it);
+        if (r != xerror_last && SERIAL_AFTER_EQ(done, r->end)) {
+            g_slice_free(ObtErrorRange, r);
+            xerror_ranges = g_slist_delete_link(xerror_ranges, it);
+        }
+    }
+}
+
 static gint xerror_handler(Display *d, XErrorEvent *e)
 {
+    ObtErrorRange *r = find_range(e->serial);
 #ifdef DEBUG
     gchar errtxt[128];
 
     XGetErrorText(d, e->error_code, errtxt, 127);
-    if (!xerror_ignore) {
+    if (!r) {
         if (e->error_code == BadWindow)
             /*g_debug(_("X Error: %s\n"), errtxt)*/;
         else
@@ -150,16 +206,44 @@ static gint xerror_handler(Display *d, XErrorEvent *e)
     } else
         g_debug("Ignoring XError code %d '%s'", e->error_code, errtxt);
 #else
-    (void)d; (void)e;
+    (void)d;
 #endif
 
-    obt_display_error_occured = TRUE;
+    if (r) r->error = TRUE;
     return 0;
 }
 
 void obt_display_ignore_errors(gboolean ignore)
 {
-    XSync(obt_display, FALSE);
+    if (ignore == xerror_ignore) return;
+
+    if (ignore) {
+        prune_ranges();
+
+        xerror_last = g_slice_new(ObtErrorRange);
+        xerror_last->start = NextRequest(obt_display);
+        xerror_last->end = xerror_last->start - 1;
+        xerror_last->error = FALSE;
+        xerror_ranges = g_slist_prepend(xerror_ranges, xerror_last);
+    }
+    else
+        /* the range is empty if no requests were made inside it */
+        xerror_last->end = NextRequest(obt_display) - 1;
     xerror_ignore = ignore;
-    if (ignore) obt_display_error_occured = FALSE;
+}
+
+gboolean obt_display_error_occured(void)
+{
+    g_return_val_if_fail(xerror_last != NULL, FALSE);
+    g_return_val_if_fail(!xerror_ignore, FALSE);
+
+    /* only wait for the server if it has not yet told us about all of the
+       requests in the range */
+    if (!xerror_last->error &&
+        !SERIAL_AFTER_EQ(LastKnownRequestProcessed(obt_display),
+                         xerror_last->end))
+    {
+        XSync(obt_display, FALSE);
+    }
+    return xerror_last->error;
 }
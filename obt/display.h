@@ -41,8 +41,6 @@
 
 G_BEGIN_DECLS
 
-extern gboolean obt_display_error_occured;
-
 extern gboolean obt_display_extension_xkb;
 extern gint     obt_display_extension_xkb_basep;
 extern gboolean obt_display_extension_shape;
@@ -61,7 +59,14 @@ extern Display* obt_display;
 gboolean obt_display_open(const char *display_name);
 void     obt_display_close(void);
 
+/*! Begin or end a range of requests whose X errors are ignored.  This does
+  not wait for the server, errors are matched to the range by their request
+  serial whenever they arrive. */
 void     obt_display_ignore_errors(gboolean ignore);
+/*! Returns TRUE if an error occured for any of the requests in the most
+  recent range given to obt_display_ignore_errors().  This only waits for the
+  server if it has not processed all of those requests yet. */
+gboolean obt_display_error_occured(void);
 
 #define  obt_root(screen) (RootWindow(obt_display, screen))
 
@@ -20,8 +20,24 @@
 #ifndef __obt_internal_h
 #define __obt_internal_h
 
+#include <X11/Xlib.h>
+#include <libxml/tree.h>
+#include <glib.h>
+
+struct _ObtPaths;
+
 void obt_prop_startup(void);
+void obt_prop_cache_shutdown(void);
+/*! Invalidate cached properties which are changed by the event */
+void obt_prop_cache_event(const XEvent *e);
 
 void obt_keyboard_shutdown(void);
 
+/*! Returns the XML document at @path as it was saved in the cache, or NULL if
+  it is not there or it or any of the files it included have changed */
+xmlDocPtr obt_xml_cache_load(struct _ObtPaths *p, const gchar *path);
+/*! Save a document, which was loaded from @path, in the cache */
+void obt_xml_cache_save(struct _ObtPaths *p, const gchar *path,
+                        xmlDocPtr doc);
+
 #endif /* __obt_internal_h */
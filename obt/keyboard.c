@@ -21,6 +21,9 @@
 
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
 
 struct _ObtIC
 {
@@ -42,6 +45,8 @@ struct _ObtIC
 #define nth_mask(n) (1 << n)
 
 static void set_modkey_mask(guchar mask, KeySym sym);
+static void update_modkeys(void);
+static void build_keysym_index(void);
 static void xim_init(void);
 void obt_keyboard_shutdown();
 void obt_keyboard_context_renew(ObtIC *ic);
@@ -49,6 +54,9 @@ void obt_keyboard_context_renew(ObtIC *ic);
 static XModifierKeymap *modmap;
 static KeySym *keymap;
 static gint min_keycode, max_keycode, keysyms_per_keycode;
+/*! Maps a KeySym to a zero-terminated GArray of the KeyCodes which generate
+  it, in the same order that XKeysymToKeycode() would search them */
+static GHashTable *keysym_index;
 /*! This is a bitmask of the different masks for each modifier key */
 static guchar modkeys_keys[OBT_KEYBOARD_NUM_MODKEYS];
 
@@ -65,17 +73,11 @@ static GSList *xic_all = NULL;
 
 void obt_keyboard_reload(void)
 {
-    gint i, j, k;
-
     if (started) obt_keyboard_shutdown(); /* free stuff */
     started = TRUE;
 
     xim_init();
 
-    /* reset the keys to not be bound to any masks */
-    for (i = 0; i < OBT_KEYBOARD_NUM_MODKEYS; ++i)
-        modkeys_keys[i] = 0;
-
     modmap = XGetModifierMapping(obt_display);
     /* note: modmap->max_keypermod can be 0 when there is no valid key layout
        available */
@@ -85,6 +87,112 @@ void obt_keyboard_reload(void)
                                  max_keycode - min_keycode + 1,
                                  &keysyms_per_keycode);
 
+    build_keysym_index();
+    update_modkeys();
+}
+
+gboolean obt_keyboard_update_keycodes(gint first, gint n, gboolean mods)
+{
+    KeySym *syms;
+    gint per;
+    gboolean changed;
+
+    if (!started) {
+        obt_keyboard_reload();
+        return TRUE;
+    }
+
+    changed = FALSE;
+
+    if (n > 0) {
+        if (first < min_keycode || first + n - 1 > max_keycode) {
+            /* the keycode range changed, so start over */
+            obt_keyboard_reload();
+            return TRUE;
+        }
+
+        syms = XGetKeyboardMapping(obt_display, first, n, &per);
+        if (!syms)
+            return FALSE;
+        if (per != keysyms_per_keycode) {
+            /* the shape of the map changed, so start over */
+            XFree(syms);
+            obt_keyboard_reload();
+            return TRUE;
+        }
+
+        if (memcmp(syms, keymap + (first - min_keycode) * per,
+                   n * per * sizeof(KeySym)))
+        {
+            memcpy(keymap + (first - min_keycode) * per, syms,
+                   n * per * sizeof(KeySym));
+            build_keysym_index();
+            changed = TRUE;
+        }
+        XFree(syms);
+    }
+
+    if (mods) {
+        XFreeModifiermap(modmap);
+        modmap = XGetModifierMapping(obt_display);
+        changed = TRUE;
+    }
+
+    /* the modifier keys are found by their keysyms, so either change can
+       move them around */
+    if (changed)
+        update_modkeys();
+
+    return changed;
+}
+
+static void free_keycodes(gpointer codes)
+{
+    g_array_free(codes, TRUE);
+}
+
+static void build_keysym_index(void)
+{
+    gint i, j;
+
+    if (keysym_index)
+        g_hash_table_destroy(keysym_index);
+    keysym_index = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         free_keycodes);
+
+    /* go through each column of the map, so that keycodes which generate the
+       keysym without any modifiers come first */
+    for (j = 0; j < keysyms_per_keycode; ++j)
+        for (i = min_keycode; i <= max_keycode; ++i) {
+            KeySym sym = keymap[(i-min_keycode) * keysyms_per_keycode + j];
+            GArray *codes;
+            KeyCode code = i;
+            guint k;
+
+            if (sym == NoSymbol) continue;
+
+            codes = g_hash_table_lookup(keysym_index, GUINT_TO_POINTER(sym));
+            if (!codes) {
+                codes = g_array_new(TRUE, FALSE, sizeof(KeyCode));
+                g_hash_table_insert(keysym_index, GUINT_TO_POINTER(sym),
+                                    codes);
+            }
+            /* a keycode can generate the same keysym in many columns */
+            for (k = 0; k < codes->len; ++k)
+                if (g_array_index(codes, KeyCode, k) == code) break;
+            if (k == codes->len)
+                g_array_append_val(codes, code);
+        }
+}
+
+static void update_modkeys(void)
+{
+    gint i, j, k;
+
+    /* reset the keys to not be bound to any masks */
+    for (i = 0; i < OBT_KEYBOARD_NUM_MODKEYS; ++i)
+        modkeys_keys[i] = 0;
+
     alt_l = meta_l = super_l = hyper_l = FALSE;
 
     /* go through each of the modifier masks (eg ShiftMask, CapsMask...) */
@@ -122,6 +230,8 @@ void obt_keyboard_shutdown(void)
     modmap = NULL;
     XFree(keymap);
     keymap = NULL;
+    g_hash_table_destroy(keysym_index);
+    keysym_index = NULL;
     for (it = xic_all; it; it = g_slist_next(it)) {
         ObtIC* ic = it->data;
         if (ic->xic) {
@@ -268,22 +378,13 @@ static void set_modkey_mask(guchar mask, KeySym sym)
 
 KeyCode* obt_keyboard_keysym_to_keycode(KeySym sym)
 {
-    KeyCode *ret;
-    gint i, j, n;
-
-    ret = g_new(KeyCode, 1);
-    n = 0;
-    ret[n] = 0;
-
-    /* go through each keycode and look for the keysym */
-    for (i = min_keycode; i <= max_keycode; ++i)
-        for (j = 0; j < keysyms_per_keycode; ++j)
-            if (sym == keymap[(i-min_keycode) * keysyms_per_keycode + j]) {
-                ret = g_renew(KeyCode, ret, ++n + 1);
-                ret[n-1] = i;
-                ret[n] = 0;
-            }
-    return ret;
+    GArray *codes;
+
+    codes = g_hash_table_lookup(keysym_index, GUINT_TO_POINTER(sym));
+    if (!codes)
+        return g_new0(KeyCode, 1);
+    /* copy the terminating zero too */
+    return g_memdup(codes->data, (codes->len + 1) * sizeof(KeyCode));
 }
 
 gunichar obt_keyboard_keypress_to_unichar(ObtIC *ic, XEvent *ev)
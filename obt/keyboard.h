@@ -46,6 +46,16 @@ typedef struct _ObtIC ObtIC;
 
 void obt_keyboard_reload(void);
 
+/*! Update the keyboard map after part of it has changed, without fetching
+  all of it again.
+  @param first The first keycode whose keysyms changed.
+  @param n The number of keycodes whose keysyms changed, or 0 if none did.
+  @param mods TRUE if the modifier mapping changed.
+  @return TRUE if any keycode or modifier changed, and key bindings need to be
+          translated again.
+*/
+gboolean obt_keyboard_update_keycodes(gint first, gint n, gboolean mods);
+
 /*! Get the modifier mask(s) for a keyboard event.
   (eg. a keycode bound to Alt_L could return a mask of (Mod1Mask | Mask3Mask))
 */
@@ -20,6 +20,9 @@
 #include "obt/ddparse.h"
 #include "obt/paths.h"
 #include <glib.h>
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
 
 struct _ObtLink {
     guint ref;
@@ -28,10 +31,9 @@ struct _ObtLink {
     gchar *name; /*!< Specific name for the object (eg Firefox) */
     gboolean display; /*<! When false, do not display this link in menus or
                            launchers, etc */
+    gboolean no_display; /*<! The NoDisplay key was set */
     gboolean deleted; /*<! When true, the Link could exist but is deleted
                            for the current user */
-    gchar *generic; /*!< Generic name for the object (eg Web Browser) */
-    gchar *comment; /*!< Comment/description to display for the object */
     gchar *icon; /*!< Name/path for an icon for the object */
     guint env_required; /*!< The environments that must be present to use this
                           link. */
@@ -41,12 +43,10 @@ struct _ObtLink {
     union _ObtLinkData {
         struct _ObtLinkApp {
             gchar *exec; /*!< Executable to run for the app */
-            gchar *wdir; /*!< Working dir to run the app in */
+            gchar *tryexec; /*!< The TryExec key, or NULL */
             gboolean term; /*!< Run the app in a terminal or not */
             ObtLinkAppOpen open;
 
-            gchar **mime; /*!< Mime types the app can open */
-
             GQuark *categories; /*!< Array of quarks representing the
                                   application's categories */
             gulong  n_categories; /*!< Number of categories for the app */
@@ -66,63 +66,50 @@ ObtLink* obt_link_from_ddfile(const gchar *ddname, GSList *paths,
                               ObtPaths *p)
 {
     ObtLink *link;
-    GHashTable *groups, *keys;
-    ObtDDParseGroup *g;
-    ObtDDParseValue *v;
-
-    /* parse the file, and get a hash table of the groups */
-    groups = obt_ddparse_file(ddname, paths);
-    if (!groups) return NULL; /* parsing failed */
-    /* grab the Desktop Entry group */
-    g = g_hash_table_lookup(groups, "Desktop Entry");
-    g_assert(g != NULL);
-    /* grab the keys that appeared in the Desktop Entry group */
-    keys = obt_ddparse_group_keys(g);
-
-    /* build the ObtLink (we steal all strings from the parser) */
-    link = g_slice_new0(ObtLink);
-    link->ref = 1;
-    link->display = TRUE;
-
-    v = g_hash_table_lookup(keys, "Type");
-    g_assert(v);
-    link->type = v->value.enumerable;
+    ObtDDFile *f;
 
-    if ((v = g_hash_table_lookup(keys, "Hidden")))
-        link->deleted = v->value.boolean;
+    /* map the file, only the values used here get parsed out of it */
+    f = obt_ddfile_open(ddname, paths);
+    if (!f) return NULL; /* parsing failed */
 
-    if ((v = g_hash_table_lookup(keys, "NoDisplay")))
-        link->display = !v->value.boolean;
-
-    if ((v = g_hash_table_lookup(keys, "GenericName")))
-        link->generic = v->value.string, v->value.string = NULL;
-
-    if ((v = g_hash_table_lookup(keys, "Comment")))
-        link->comment = v->value.string, v->value.string = NULL;
+    link = g_slice_new0(ObtLink);
+    link->ref = 1;
 
-    if ((v = g_hash_table_lookup(keys, "Icon")))
-        link->icon = v->value.string, v->value.string = NULL;
+    if (obt_ddfile_value_is(f, "Type", "Application"))
+        link->type = OBT_LINK_TYPE_APPLICATION;
+    else if (obt_ddfile_value_is(f, "Type", "Link"))
+        link->type = OBT_LINK_TYPE_URL;
+    else if (obt_ddfile_value_is(f, "Type", "Directory"))
+        link->type = OBT_LINK_TYPE_DIRECTORY;
+    else {
+        g_warning("Missing or unknown Type key in %s", obt_ddfile_path(f));
+        goto link_fail;
+    }
 
-    if ((v = g_hash_table_lookup(keys, "OnlyShowIn")))
-        link->env_required = v->value.environments;
-    else
-        link->env_required = 0;
+    if (!(link->name = obt_ddfile_string(f, "Name", TRUE))) {
+        g_warning("Missing Name key in %s", obt_ddfile_path(f));
+        goto link_fail;
+    }
 
-    if ((v = g_hash_table_lookup(keys, "NotShowIn")))
-        link->env_restricted = v->value.environments;
-    else
-        link->env_restricted = 0;
+    link->icon = obt_ddfile_string(f, "Icon", TRUE);
+    link->deleted = obt_ddfile_boolean(f, "Hidden", FALSE);
+    link->no_display = obt_ddfile_boolean(f, "NoDisplay", FALSE);
+    link->display = !link->no_display;
+    link->env_required = obt_ddfile_environments(f, "OnlyShowIn");
+    link->env_restricted = obt_ddfile_environments(f, "NotShowIn");
 
     /* type-specific keys */
 
     if (link->type == OBT_LINK_TYPE_APPLICATION) {
-        gchar *c;
+        gchar *c, **cats;
         gboolean percent;
+        gulong i, n;
 
-        v = g_hash_table_lookup(keys, "Exec");
-        g_assert(v);
-        link->d.app.exec = v->value.string;
-        v->value.string = NULL;
+        if (!(link->d.app.exec = obt_ddfile_string(f, "Exec", FALSE))) {
+            g_warning("Missing Exec key for Application in %s",
+                      obt_ddfile_path(f));
+            goto link_fail;
+        }
 
         /* parse link->d.app.exec to determine link->d.app.open */
         percent = FALSE;
@@ -140,66 +127,45 @@ ObtLink* obt_link_from_ddfile(const gchar *ddname, GSList *paths,
             else if (*c == '%') percent = TRUE;
         }
 
-        if ((v = g_hash_table_lookup(keys, "TryExec"))) {
-            /* XXX spawn a thread to check TryExec? */
-            link->display = link->display &&
-                obt_paths_try_exec(p, v->value.string);
-        }
-
-        if ((v = g_hash_table_lookup(keys, "Path"))) {
-            /* steal the string */
-            link->d.app.wdir = v->value.string;
-            v->value.string = NULL;
-        }
+        link->d.app.tryexec = obt_ddfile_string(f, "TryExec", FALSE);
+        if (link->display && link->d.app.tryexec)
+            link->display = obt_paths_try_exec(p, link->d.app.tryexec);
 
-        if ((v = g_hash_table_lookup(keys, "Terminal")))
-            link->d.app.term = v->value.boolean;
+        link->d.app.term = obt_ddfile_boolean(f, "Terminal", FALSE);
 
-        if ((v = g_hash_table_lookup(keys, "StartupNotify")))
-            link->d.app.startup = v->value.boolean ?
+        if (obt_ddfile_has_key(f, "StartupNotify"))
+            link->d.app.startup =
+                obt_ddfile_boolean(f, "StartupNotify", FALSE) ?
                 OBT_LINK_APP_STARTUP_PROTOCOL_SUPPORT :
                 OBT_LINK_APP_STARTUP_NO_SUPPORT;
-        else {
+        else
             link->d.app.startup = OBT_LINK_APP_STARTUP_LEGACY_SUPPORT;
-            if ((v = g_hash_table_lookup(keys, "StartupWMClass"))) {
-                /* steal the string */
-                link->d.app.startup_wmclass = v->value.string;
-                v->value.string = NULL;
-            }
-        }
+        link->d.app.startup_wmclass =
+            obt_ddfile_string(f, "StartupWMClass", FALSE);
 
-        if ((v = g_hash_table_lookup(keys, "Categories"))) {
-            gulong i;
-            gchar *end;
+        if ((cats = obt_ddfile_strings(f, "Categories", FALSE, &n))) {
+            link->d.app.categories = g_new(GQuark, n);
+            link->d.app.n_categories = n;
 
-            link->d.app.categories = g_new(GQuark, v->value.strings.n);
-            link->d.app.n_categories = v->value.strings.n;
-
-            for (i = 0; i < v->value.strings.n; ++i) {
-                link->d.app.categories[i] =
-                    g_quark_from_string(v->value.strings.a[i]);
-                c = end = end+1; /* next */
-            }
-        }
-
-        if ((v = g_hash_table_lookup(keys, "MimeType"))) {
-            /* steal the string array */
-            link->d.app.mime = v->value.strings.a;
-            v->value.strings.a = NULL;
-            v->value.strings.n = 0;
+            for (i = 0; i < n; ++i)
+                link->d.app.categories[i] = g_quark_from_string(cats[i]);
+            g_strfreev(cats);
         }
     }
     else if (link->type == OBT_LINK_TYPE_URL) {
-        v = g_hash_table_lookup(keys, "URL");
-        g_assert(v);
-        link->d.url.addr = v->value.string;
-        v->value.string = NULL;
+        if (!(link->d.url.addr = obt_ddfile_string(f, "URL", FALSE))) {
+            g_warning("Missing URL key for Link in %s", obt_ddfile_path(f));
+            goto link_fail;
+        }
     }
 
-    /* destroy the parsing info */
-    g_hash_table_destroy(groups);
-
+    obt_ddfile_close(f);
     return link;
+
+link_fail:
+    obt_ddfile_close(f);
+    obt_link_unref(link);
+    return NULL;
 }
 
 void obt_link_ref(ObtLink *dd)
@@ -211,13 +177,10 @@ void obt_link_unref(ObtLink *dd)
 {
     if (--dd->ref < 1) {
         g_free(dd->name);
-        g_free(dd->generic);
-        g_free(dd->comment);
         g_free(dd->icon);
         if (dd->type == OBT_LINK_TYPE_APPLICATION) {
             g_free(dd->d.app.exec);
-            g_free(dd->d.app.wdir);
-            g_strfreev(dd->d.app.mime);
+            g_free(dd->d.app.tryexec);
             g_free(dd->d.app.categories);
             g_free(dd->d.app.startup_wmclass);
         }
@@ -227,6 +190,76 @@ void obt_link_unref(ObtLink *dd)
     }
 }
 
+gboolean obt_link_deleted(ObtLink *e)
+{
+    return e->deleted;
+}
+
+ObtLinkType obt_link_type(ObtLink *e)
+{
+    return e->type;
+}
+
+gboolean obt_link_display(ObtLink *e, const gchar *env)
+{
+    guint mask = 0;
+
+    if (!e->display) return FALSE;
+
+    if (env) {
+        gchar **names, **it;
+
+        names = g_strsplit(env, ";", -1);
+        for (it = names; *it; ++it) {
+            if (!strcmp(*it, "OPENBOX")) mask |= OBT_LINK_ENV_OPENBOX;
+            else if (!strcmp(*it, "GNOME")) mask |= OBT_LINK_ENV_GNOME;
+            else if (!strcmp(*it, "KDE")) mask |= OBT_LINK_ENV_KDE;
+            else if (!strcmp(*it, "LXDE")) mask |= OBT_LINK_ENV_LXDE;
+            else if (!strcmp(*it, "ROX")) mask |= OBT_LINK_ENV_ROX;
+            else if (!strcmp(*it, "XFCE")) mask |= OBT_LINK_ENV_XFCE;
+            else if (!strcmp(*it, "Old")) mask |= OBT_LINK_ENV_OLD;
+        }
+        g_strfreev(names);
+    }
+
+    if (e->env_required && !(e->env_required & mask)) return FALSE;
+    if (e->env_restricted & mask) return FALSE;
+    return TRUE;
+}
+
+gboolean obt_link_display_any(ObtLink *e)
+{
+    return !e->no_display;
+}
+
+const gchar* obt_link_name(ObtLink *e)
+{
+    return e->name;
+}
+
+const gchar* obt_link_icon(ObtLink *e)
+{
+    return e->icon;
+}
+
+const gchar* obt_link_app_executable(ObtLink *e)
+{
+    g_return_val_if_fail(e->type == OBT_LINK_TYPE_APPLICATION, NULL);
+    return e->d.app.exec;
+}
+
+const gchar* obt_link_app_try_exec(ObtLink *e)
+{
+    g_return_val_if_fail(e->type == OBT_LINK_TYPE_APPLICATION, NULL);
+    return e->d.app.tryexec;
+}
+
+const gchar* obt_link_app_startup_wmclass(ObtLink *e)
+{
+    g_return_val_if_fail(e->type == OBT_LINK_TYPE_APPLICATION, NULL);
+    return e->d.app.startup_wmclass;
+}
+
 const GQuark* obt_link_app_categories(ObtLink *e, gulong *n)
 {
     g_return_val_if_fail(e != NULL, NULL);
@@ -83,10 +83,12 @@ ObtLinkType obt_link_type (ObtLink *e);
          GNOME, KDE, ROX, XFCE.  Other environments not listed here may also
          be supported.  This can be null also if not listing any environment. */
 gboolean obt_link_display(ObtLink *e, const gchar *env);
+/*! Returns FALSE if the .desktop file should not be displayed to users in any
+    environment, due to NoDisplay.  TryExec, OnlyShowIn and NotShowIn are not
+    considered. */
+gboolean obt_link_display_any(ObtLink *e);
 
 const gchar* obt_link_name           (ObtLink *e);
-const gchar* obt_link_generic_name   (ObtLink *e);
-const gchar* obt_link_comment        (ObtLink *e);
 /*! Returns the icon for the object referred to by the .desktop file.
     Returns either an absolute path, or a string which can be used to find the
     icon using the algorithm given by:
@@ -97,10 +99,10 @@ const gchar* obt_link_icon           (ObtLink *e);
 const gchar *obt_link_url_path(ObtLink *e);
 
 const gchar*  obt_link_app_executable      (ObtLink *e);
-/*! Returns the path in which the application should be run */
-const gchar*  obt_link_app_path            (ObtLink *e);
+/*! Returns the TryExec key, the program which must be installed for the
+    application to be displayed, or NULL if there is none */
+const gchar*  obt_link_app_try_exec        (ObtLink *e);
 gboolean      obt_link_app_run_in_terminal (ObtLink *e);
-const gchar*const* obt_link_app_mime_types      (ObtLink *e);
 const GQuark* obt_link_app_categories      (ObtLink *e, gulong *n);
 /*! Returns a combination of values in the ObtLinkAppOpen enum,
     specifying if the application can be launched to open one or more files
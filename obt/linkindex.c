@@ -0,0 +1,653 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/linkindex.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "obt/linkindex.h"
+#include "obt/link.h"
+#include "obt/paths.h"
+#include "obt/watch.h"
+#include <glib.h>
+
+#ifdef HAVE_STDLIB_H
+#  include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <time.h>
+
+#define INDEX_HEADER "OBT-LINKINDEX 3"
+
+/*! A .desktop file in one of the applications directories */
+typedef struct _IndexFile {
+    gchar *name; /*!< The file name, inside its directory */
+    gchar *id; /*!< The desktop-file id */
+    time_t mtime; /*!< 0 if the file should be parsed again */
+    gboolean hidden; /*!< The file hides other files with the same id */
+    ObtLinkIndexApp *app; /*!< NULL if the file is not an application */
+    /*! The keys which decide app->display.  They are saved rather than
+      app->display, since a TryExec program can be installed or removed
+      without the file changing. */
+    gboolean no_display;
+    gchar *try_exec;
+} IndexFile;
+
+/*! An applications directory, or a subdirectory of one */
+typedef struct _IndexDir {
+    gchar *path;
+    gchar *prefix; /*!< Prepended to file names to make their desktop-ids */
+    time_t mtime; /*!< 0 if the directory should be read again */
+    GHashTable *files; /*!< file name -> IndexFile */
+    GSList *subdirs; /*!< names of the subdirectories */
+} IndexDir;
+
+struct _ObtLinkIndex {
+    guint ref;
+    ObtPaths *paths;
+    gchar *cache_path;
+
+    /*! path -> IndexDir, for every directory in the index */
+    GHashTable *dirs;
+    /*! desktop-id -> IndexFile, with the file which wins for each id */
+    GHashTable *by_id;
+    /*! StartupWMClass -> ObtLinkIndexApp */
+    GHashTable *by_wmclass;
+
+    ObtWatch *watch;
+    GSList *watched; /*!< The directories added to the watch */
+    ObtLinkIndexFunc func;
+    gpointer data;
+};
+
+static void index_app_free(ObtLinkIndexApp *a)
+{
+    if (a) {
+        g_free(a->name);
+        g_free(a->exec);
+        g_free(a->icon);
+        g_free(a->wmclass);
+        g_free(a->categories);
+        g_slice_free(ObtLinkIndexApp, a);
+    }
+}
+
+static void index_file_free(IndexFile *f)
+{
+    index_app_free(f->app);
+    g_free(f->try_exec);
+    g_free(f->name);
+    g_free(f->id);
+    g_slice_free(IndexFile, f);
+}
+
+static IndexFile* index_file_new(IndexDir *d, const gchar *name)
+{
+    IndexFile *f;
+
+    f = g_slice_new0(IndexFile);
+    f->name = g_strdup(name);
+    f->id = g_strconcat(d->prefix, name, NULL);
+    g_hash_table_replace(d->files, f->name, f);
+    return f;
+}
+
+static IndexDir* index_dir_new(ObtLinkIndex *i, const gchar *path,
+                               const gchar *prefix)
+{
+    IndexDir *d;
+
+    d = g_slice_new0(IndexDir);
+    d->path = g_strdup(path);
+    d->prefix = g_strdup(prefix);
+    d->files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                     (GDestroyNotify)index_file_free);
+    g_hash_table_replace(i->dirs, d->path, d);
+    return d;
+}
+
+static void index_dir_free(IndexDir *d)
+{
+    GSList *it;
+
+    for (it = d->subdirs; it; it = g_slist_next(it))
+        g_free(it->data);
+    g_slist_free(d->subdirs);
+    g_hash_table_destroy(d->files);
+    g_free(d->path);
+    g_free(d->prefix);
+    g_slice_free(IndexDir, d);
+}
+
+/*! Returns if an application should be displayed, looking for its TryExec
+  program now */
+static gboolean file_display(ObtLinkIndex *i, IndexFile *f)
+{
+    return !f->no_display &&
+        (!f->try_exec || obt_paths_try_exec(i->paths, f->try_exec));
+}
+
+/*! Parse a .desktop file into the index */
+static void parse_file(ObtLinkIndex *i, IndexDir *d, IndexFile *f)
+{
+    GSList dirs = { NULL, NULL };
+    ObtLink *link;
+
+    index_app_free(f->app);
+    f->app = NULL;
+    f->hidden = FALSE;
+    g_free(f->try_exec);
+    f->try_exec = NULL;
+
+    dirs.data = d->path;
+    if (!(link = obt_link_from_ddfile(f->name, &dirs, i->paths)))
+        return;
+
+    if (obt_link_deleted(link))
+        f->hidden = TRUE;
+    else if (obt_link_type(link) == OBT_LINK_TYPE_APPLICATION) {
+        ObtLinkIndexApp *a;
+        const GQuark *cats;
+
+        a = f->app = g_slice_new0(ObtLinkIndexApp);
+        a->id = f->id;
+        a->name = g_strdup(obt_link_name(link));
+        a->exec = g_strdup(obt_link_app_executable(link));
+        a->icon = g_strdup(obt_link_icon(link));
+        a->wmclass = g_strdup(obt_link_app_startup_wmclass(link));
+        f->no_display = !obt_link_display_any(link);
+        f->try_exec = g_strdup(obt_link_app_try_exec(link));
+        a->display = file_display(i, f);
+        cats = obt_link_app_categories(link, &a->n_categories);
+        a->categories = g_memdup(cats, a->n_categories * sizeof(GQuark));
+    }
+    obt_link_unref(link);
+}
+
+static gboolean is_desktop_file(const gchar *name)
+{
+    return g_str_has_suffix(name, ".desktop");
+}
+
+/*! Bring one directory up to date, and its subdirectories, and add them all
+  to @order.  Returns TRUE if anything in them changed. */
+static gboolean update_dir(ObtLinkIndex *i, GHashTable *old,
+                           const gchar *path, const gchar *prefix,
+                           GSList **order)
+{
+    IndexDir *d;
+    struct stat st;
+    gboolean changed = FALSE;
+    GSList *it;
+
+    if (stat(path, &st) || !S_ISDIR(st.st_mode))
+        return FALSE; /* if it was in the index, it is removed with old */
+
+    if ((d = g_hash_table_lookup(old, path)))
+        g_hash_table_steal(old, path);
+    else {
+        d = index_dir_new(i, path, prefix);
+        changed = TRUE;
+    }
+    g_hash_table_replace(i->dirs, d->path, d);
+    *order = g_slist_prepend(*order, d);
+
+    /* files are only added, removed or renamed when the directory's mtime
+       changes.  a file changed in place is caught by the watch, which sets
+       the directory's mtime to 0 */
+    if (d->mtime == 0 || d->mtime != st.st_mtime) {
+        GHashTable *files;
+        GDir *dir;
+        const gchar *n;
+        time_t now;
+
+        files = d->files;
+        d->files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                         (GDestroyNotify)index_file_free);
+        for (it = d->subdirs; it; it = g_slist_next(it))
+            g_free(it->data);
+        g_slist_free(d->subdirs);
+        d->subdirs = NULL;
+
+        /* anything changed within the same second as it is read could
+           change again without its mtime changing, so look at it again
+           next time */
+        now = time(NULL);
+
+        if ((dir = g_dir_open(path, 0, NULL))) {
+            while ((n = g_dir_read_name(dir))) {
+                gchar *p;
+                struct stat fst;
+                IndexFile *f;
+
+                p = g_build_filename(path, n, NULL);
+                if (stat(p, &fst)) {
+                    g_free(p);
+                    continue;
+                }
+                g_free(p);
+
+                if (S_ISDIR(fst.st_mode)) {
+                    d->subdirs = g_slist_prepend(d->subdirs, g_strdup(n));
+                    continue;
+                }
+                if (!is_desktop_file(n)) continue;
+
+                if ((f = g_hash_table_lookup(files, n))) {
+                    g_hash_table_steal(files, n);
+                    g_hash_table_replace(d->files, f->name, f);
+                }
+                else
+                    f = index_file_new(d, n);
+
+                if (f->mtime == 0 || f->mtime != fst.st_mtime) {
+                    parse_file(i, d, f);
+                    f->mtime = fst.st_mtime == now ? 0 : fst.st_mtime;
+                    changed = TRUE;
+                }
+            }
+            g_dir_close(dir);
+        }
+        d->subdirs = g_slist_reverse(d->subdirs);
+
+        /* whatever is left in the old table was removed */
+        if (g_hash_table_size(files)) changed = TRUE;
+        g_hash_table_destroy(files);
+
+        d->mtime = st.st_mtime == now ? 0 : st.st_mtime;
+    }
+
+    for (it = d->subdirs; it; it = g_slist_next(it)) {
+        gchar *p, *pre;
+
+        p = g_build_filename(path, it->data, NULL);
+        pre = g_strconcat(prefix, it->data, "-", NULL);
+        if (update_dir(i, old, p, pre, order))
+            changed = TRUE;
+        g_free(p);
+        g_free(pre);
+    }
+    return changed;
+}
+
+static void add_winner(gpointer key, gpointer value, gpointer data)
+{
+    ObtLinkIndex *i = data;
+    IndexFile *f = value;
+
+    if (!f->app && !f->hidden) return; /* not an application */
+    if (g_hash_table_lookup(i->by_id, f->id)) return; /* shadowed */
+
+    g_hash_table_insert(i->by_id, f->id, f);
+    if (f->app && f->app->wmclass &&
+        !g_hash_table_lookup(i->by_wmclass, f->app->wmclass))
+        g_hash_table_insert(i->by_wmclass, f->app->wmclass, f->app);
+}
+
+/*! Pick the file which wins for each desktop-id.  @order lists the
+  directories from the most important to the least. */
+static void rebuild_lookups(ObtLinkIndex *i, GSList *order)
+{
+    GSList *it;
+
+    g_hash_table_remove_all(i->by_id);
+    g_hash_table_remove_all(i->by_wmclass);
+
+    for (it = order; it; it = g_slist_next(it)) {
+        IndexDir *d = it->data;
+        g_hash_table_foreach(d->files, add_winner, i);
+    }
+}
+
+static void save_field(GString *buf, const gchar *s)
+{
+    gchar *e;
+
+    e = g_strescape(s ? s : "", NULL);
+    g_string_append_c(buf, '\t');
+    g_string_append(buf, e);
+    g_free(e);
+}
+
+static void save_file(gpointer key, gpointer value, gpointer data)
+{
+    IndexFile *f = value;
+    GString *buf = data;
+
+    g_string_append_printf(buf, "F\t%lu", (gulong)f->mtime);
+    save_field(buf, f->name);
+    if (f->app) {
+        ObtLinkIndexApp *a = f->app;
+        gulong n;
+
+        g_string_append_printf(buf, "\tA%c", f->no_display ? 'n' : '-');
+        save_field(buf, a->name);
+        save_field(buf, a->exec);
+        save_field(buf, a->icon);
+        save_field(buf, a->wmclass);
+        g_string_append_c(buf, '\t');
+        for (n = 0; n < a->n_categories; ++n) {
+            gchar *e = g_strescape(g_quark_to_string(a->categories[n]), NULL);
+            g_string_append_printf(buf, "%s;", e);
+            g_free(e);
+        }
+        save_field(buf, f->try_exec);
+    }
+    else
+        g_string_append(buf, f->hidden ? "\tH" : "\t-");
+    g_string_append_c(buf, '\n');
+}
+
+static void save_dir(gpointer key, gpointer value, gpointer data)
+{
+    IndexDir *d = value;
+    GString *buf = data;
+    GSList *it;
+
+    g_string_append_printf(buf, "D\t%lu", (gulong)d->mtime);
+    save_field(buf, d->path);
+    save_field(buf, d->prefix);
+    g_string_append_c(buf, '\n');
+    for (it = d->subdirs; it; it = g_slist_next(it)) {
+        g_string_append(buf, "S");
+        save_field(buf, it->data);
+        g_string_append_c(buf, '\n');
+    }
+    g_hash_table_foreach(d->files, save_file, buf);
+}
+
+static void save(ObtLinkIndex *i)
+{
+    GString *buf;
+    gchar *dir;
+
+    dir = g_path_get_dirname(i->cache_path);
+    obt_paths_mkdir_path(dir, 0700);
+    g_free(dir);
+
+    buf = g_string_new(INDEX_HEADER "\n");
+    g_hash_table_foreach(i->dirs, save_dir, buf);
+    if (!g_file_set_contents(i->cache_path, buf->str, buf->len, NULL))
+        g_message("Unable to save the application index to %s",
+                  i->cache_path);
+    g_string_free(buf, TRUE);
+}
+
+/*! Read the index saved by save().  Anything which can not be understood
+  ends the loading, and whatever was not loaded is read from the
+  directories again. */
+static void load(ObtLinkIndex *i)
+{
+    gchar *contents, **lines, **it;
+    IndexDir *d = NULL;
+
+    if (!g_file_get_contents(i->cache_path, &contents, NULL, NULL))
+        return;
+    lines = g_strsplit(contents, "\n", -1);
+    g_free(contents);
+
+    if (!lines[0] || strcmp(lines[0], INDEX_HEADER)) {
+        g_strfreev(lines);
+        return;
+    }
+
+    for (it = lines + 1; *it && **it; ++it) {
+        gchar **v;
+        guint n, j;
+
+        v = g_strsplit(*it, "\t", -1);
+        n = g_strv_length(v);
+        for (j = 1; j < n; ++j) {
+            gchar *c = g_strcompress(v[j]);
+            g_free(v[j]);
+            v[j] = c;
+        }
+
+        if (!strcmp(v[0], "D") && n == 4) {
+            d = index_dir_new(i, v[2], v[3]);
+            d->mtime = strtoul(v[1], NULL, 10);
+        }
+        else if (!strcmp(v[0], "S") && n == 2 && d)
+            d->subdirs = g_slist_append(d->subdirs, g_strdup(v[1]));
+        else if (!strcmp(v[0], "F") && n >= 4 && d) {
+            IndexFile *f;
+
+            f = index_file_new(d, v[2]);
+            f->mtime = strtoul(v[1], NULL, 10);
+            if (v[3][0] == 'H')
+                f->hidden = TRUE;
+            else if (v[3][0] == 'A' && n == 10) {
+                ObtLinkIndexApp *a;
+                gchar **cats;
+                guint c;
+
+                a = f->app = g_slice_new0(ObtLinkIndexApp);
+                a->id = f->id;
+                a->name = g_strdup(v[4]);
+                a->exec = g_strdup(v[5]);
+                a->icon = v[6][0] ? g_strdup(v[6]) : NULL;
+                a->wmclass = v[7][0] ? g_strdup(v[7]) : NULL;
+
+                cats = g_strsplit(v[8], ";", -1);
+                a->n_categories = g_strv_length(cats);
+                if (a->n_categories) --a->n_categories; /* trailing ; */
+                a->categories = g_new(GQuark, a->n_categories);
+                for (c = 0; c < a->n_categories; ++c)
+                    a->categories[c] = g_quark_from_string(cats[c]);
+                g_strfreev(cats);
+
+                f->no_display = v[3][1] == 'n';
+                f->try_exec = v[9][0] ? g_strdup(v[9]) : NULL;
+                a->display = file_display(i, f);
+            }
+            else if (v[3][0] != '-')
+                f->mtime = 0; /* parse it again */
+        }
+        else {
+            g_strfreev(v);
+            break;
+        }
+        g_strfreev(v);
+    }
+    g_strfreev(lines);
+}
+
+/*! Bring the whole index up to date.  The lookups are built again if
+  anything changed or when @rebuild is TRUE. */
+static gboolean refresh(ObtLinkIndex *i, gboolean rebuild)
+{
+    GHashTable *old;
+    GSList *order, *it;
+    gboolean changed = FALSE;
+
+    old = i->dirs;
+    i->dirs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                    (GDestroyNotify)index_dir_free);
+
+    order = NULL;
+    for (it = obt_paths_data_dirs(i->paths); it; it = g_slist_next(it)) {
+        gchar *p = g_build_filename(it->data, "applications", NULL);
+        /* a directory can be listed twice, only the first one counts */
+        if (!g_hash_table_lookup(i->dirs, p))
+            if (update_dir(i, old, p, "", &order))
+                changed = TRUE;
+        g_free(p);
+    }
+    order = g_slist_reverse(order);
+
+    /* the directories left behind are gone */
+    if (g_hash_table_size(old)) changed = TRUE;
+    g_hash_table_destroy(old);
+
+    if (changed || rebuild)
+        rebuild_lookups(i, order);
+    if (changed)
+        save(i);
+    g_slist_free(order);
+    return changed;
+}
+
+ObtLinkIndex* obt_linkindex_new(ObtPaths *p)
+{
+    ObtLinkIndex *i;
+
+    i = g_slice_new0(ObtLinkIndex);
+    i->ref = 1;
+    i->paths = p;
+    obt_paths_ref(p);
+    i->cache_path = g_build_filename(obt_paths_cache_home(p), "openbox",
+                                     "linkindex", NULL);
+    i->dirs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                    (GDestroyNotify)index_dir_free);
+    i->by_id = g_hash_table_new(g_str_hash, g_str_equal);
+    i->by_wmclass = g_hash_table_new(g_str_hash, g_str_equal);
+
+    load(i);
+    refresh(i, TRUE);
+    return i;
+}
+
+void obt_linkindex_ref(ObtLinkIndex *i)
+{
+    ++i->ref;
+}
+
+void obt_linkindex_unref(ObtLinkIndex *i)
+{
+    if (i && --i->ref == 0) {
+        obt_linkindex_watch(i, NULL, NULL, NULL);
+        g_hash_table_destroy(i->by_wmclass);
+        g_hash_table_destroy(i->by_id);
+        g_hash_table_destroy(i->dirs);
+        g_free(i->cache_path);
+        obt_paths_unref(i->paths);
+        g_slice_free(ObtLinkIndex, i);
+    }
+}
+
+gboolean obt_linkindex_refresh(ObtLinkIndex *i)
+{
+    return refresh(i, FALSE);
+}
+
+static void watch_notify(ObtWatch *w, const gchar *base_path,
+                         const gchar *subpath, ObtWatchNotifyType type,
+                         gpointer data)
+{
+    ObtLinkIndex *i = data;
+    gchar *path, *dir;
+    IndexDir *d;
+
+    /* make the directory holding the file get read again, which finds
+       files that were changed in place, too */
+    path = g_build_filename(base_path, subpath, NULL);
+    if ((d = g_hash_table_lookup(i->dirs, path)))
+        d->mtime = 0;
+    dir = g_path_get_dirname(path);
+    if ((d = g_hash_table_lookup(i->dirs, dir))) {
+        gchar *name = g_path_get_basename(path);
+        IndexFile *f;
+
+        d->mtime = 0;
+        if ((f = g_hash_table_lookup(d->files, name)))
+            f->mtime = 0;
+        g_free(name);
+    }
+    g_free(dir);
+    g_free(path);
+
+    if (refresh(i, FALSE) && i->func)
+        i->func(i, i->data);
+}
+
+void obt_linkindex_watch(ObtLinkIndex *i, ObtWatch *w,
+                         ObtLinkIndexFunc func, gpointer data)
+{
+    GSList *it;
+
+    if (i->watch) {
+        for (it = i->watched; it; it = g_slist_next(it)) {
+            obt_watch_remove(i->watch, it->data);
+            g_free(it->data);
+        }
+        g_slist_free(i->watched);
+        i->watched = NULL;
+        obt_watch_unref(i->watch);
+        i->watch = NULL;
+    }
+
+    i->func = func;
+    i->data = data;
+
+    if (w) {
+        i->watch = w;
+        obt_watch_ref(w);
+        for (it = obt_paths_data_dirs(i->paths); it; it = g_slist_next(it)) {
+            gchar *p = g_build_filename(it->data, "applications", NULL);
+            if (obt_watch_add(w, p, TRUE, watch_notify, i))
+                i->watched = g_slist_prepend(i->watched, p);
+            else
+                g_free(p);
+        }
+        /* catch anything that changed before the watch was set up */
+        if (refresh(i, FALSE) && func)
+            func(i, data);
+    }
+}
+
+const ObtLinkIndexApp* obt_linkindex_find(ObtLinkIndex *i,
+                                          const gchar *desktop_id)
+{
+    IndexFile *f;
+
+    f = g_hash_table_lookup(i->by_id, desktop_id);
+    return f ? f->app : NULL;
+}
+
+const ObtLinkIndexApp* obt_linkindex_find_wmclass(ObtLinkIndex *i,
+                                                  const gchar *wmclass)
+{
+    return g_hash_table_lookup(i->by_wmclass, wmclass);
+}
+
+typedef struct {
+    ObtLinkIndexForeachFunc func;
+    gpointer data;
+} ForeachData;
+
+static void foreach_app(gpointer key, gpointer value, gpointer data)
+{
+    IndexFile *f = value;
+    ForeachData *fd = data;
+
+    if (f->app) fd->func(f->app, fd->data);
+}
+
+void obt_linkindex_foreach(ObtLinkIndex *i, ObtLinkIndexForeachFunc func,
+                           gpointer data)
+{
+    ForeachData fd;
+
+    fd.func = func;
+    fd.data = data;
+    g_hash_table_foreach(i->by_id, foreach_app, &fd);
+}
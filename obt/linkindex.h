@@ -0,0 +1,93 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/linkindex.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __obt_linkindex_h
+#define __obt_linkindex_h
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+struct _ObtPaths;
+struct _ObtWatch;
+
+typedef struct _ObtLinkIndex    ObtLinkIndex;
+typedef struct _ObtLinkIndexApp ObtLinkIndexApp;
+
+/*! An application found in the XDG applications directories.  The fields
+  are owned by the index and must not be changed. */
+struct _ObtLinkIndexApp {
+    const gchar *id; /*!< The desktop-file id, such as kde4-konsole.desktop */
+    gchar *name; /*!< The Name of the application */
+    gchar *exec; /*!< The Exec key, including its field codes */
+    gchar *icon; /*!< The Icon key, an icon name or an absolute path */
+    gchar *wmclass; /*!< The StartupWMClass key, or NULL */
+    GQuark *categories; /*!< Quarks for the application's categories */
+    gulong n_categories;
+    /*! FALSE if the application should not be shown in menus and launchers,
+      due to NoDisplay or a failing TryExec.  TryExec is looked for when the
+      index is loaded and when the file is parsed.  OnlyShowIn and NotShowIn
+      are not considered. */
+    gboolean display;
+};
+
+/*! Called when the index changed after a notification from an ObtWatch */
+typedef void (*ObtLinkIndexFunc)(ObtLinkIndex *i, gpointer data);
+
+typedef void (*ObtLinkIndexForeachFunc)(const ObtLinkIndexApp *app,
+                                        gpointer data);
+
+/*! Create an index of the applications in the "applications" directory of
+  each XDG data directory.  The index is read from the cache directory if it
+  was saved there before, and then brought up to date.
+*/
+ObtLinkIndex* obt_linkindex_new(struct _ObtPaths *p);
+void obt_linkindex_ref(ObtLinkIndex *i);
+void obt_linkindex_unref(ObtLinkIndex *i);
+
+/*! Bring the index up to date.  Only directories whose modification time
+  changed are read again, and only the .desktop files in them that changed
+  are parsed.  The index is saved to the cache directory when it changes.
+  Returns TRUE if anything in the index changed.
+*/
+gboolean obt_linkindex_refresh(ObtLinkIndex *i);
+
+/*! Use @w to refresh the index when the applications directories change,
+  instead of waiting for a call to obt_linkindex_refresh().  This also catches
+  files being changed in place, which does not change their directory's
+  modification time.  @func is called each time the index changes.
+*/
+void obt_linkindex_watch(ObtLinkIndex *i, struct _ObtWatch *w,
+                         ObtLinkIndexFunc func, gpointer data);
+
+/*! Find an application by its desktop-file id.  Returns NULL if there is no
+  such application, or it has been hidden by the user. */
+const ObtLinkIndexApp* obt_linkindex_find(ObtLinkIndex *i,
+                                          const gchar *desktop_id);
+
+/*! Find an application by the StartupWMClass of its .desktop file. */
+const ObtLinkIndexApp* obt_linkindex_find_wmclass(ObtLinkIndex *i,
+                                                  const gchar *wmclass);
+
+/*! Call @func for each application in the index, in no particular order. */
+void obt_linkindex_foreach(ObtLinkIndex *i, ObtLinkIndexForeachFunc func,
+                           gpointer data);
+
+G_END_DECLS
+
+#endif
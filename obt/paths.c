@@ -41,6 +41,27 @@
 #ifdef HAVE_PWD_H
 #  include <pwd.h>
 #endif
+#include <time.h>
+
+/*! How often to look for changes in the directories in $PATH, in seconds */
+#define EXEC_CHECK_INTERVAL 2
+
+typedef enum {
+    EXEC_UNKNOWN = 1, /* the file exists, but has not been checked yet */
+    EXEC_YES,
+    EXEC_NO
+} ObtPathsExecState;
+
+/*! A directory in $PATH, and the files found in it */
+typedef struct _ObtPathsExecDir
+{
+    gchar      *path;
+    /*! The mtime of the directory when its files were read, or 0 if they
+      need to be read again */
+    time_t      mtime;
+    /*! Maps the name of each file in the directory to an ObtPathsExecState */
+    GHashTable *files;
+} ObtPathsExecDir;
 
 struct _ObtPaths
 {
@@ -48,10 +69,16 @@ struct _ObtPaths
     gchar  *config_home;
     gchar  *data_home;
     gchar  *cache_home;
+    gchar  *runtime_dir;
     GSList *config_dirs;
     GSList *data_dirs;
     GSList *autostart_dirs;
-    GSList *exec_dirs;
+    GSList *exec_dirs; /* list of ObtPathsExecDir */
+    /*! Maps names without a directory to their ObtPathsExecState, for the
+      files that have been looked for in $PATH */
+    GHashTable *exec_cache;
+    /*! When the exec_dirs were last checked for changes */
+    time_t  exec_checked;
 
     uid_t   uid;
     gid_t  *gid;
@@ -161,6 +188,11 @@ ObtPaths* obt_paths_new(void)
     else
         p->cache_home = g_build_filename(g_get_home_dir(), ".cache", NULL);
 
+    /* there is no default for this one */
+    path = g_getenv("XDG_RUNTIME_DIR");
+    if (path && path[0] != '\0') /* not unset or empty */
+        p->runtime_dir = g_build_filename(path, NULL);
+
     path = g_getenv("XDG_CONFIG_DIRS");
     if (path && path[0] != '\0') /* not unset or empty */
         p->config_dirs = split_paths(path);
@@ -210,6 +242,16 @@ ObtPaths* obt_paths_new(void)
         p->exec_dirs = split_paths(path);
     else
         p->exec_dirs = NULL;
+    for (it = p->exec_dirs; it; it = g_slist_next(it)) {
+        ObtPathsExecDir *d = g_slice_new(ObtPathsExecDir);
+        d->path = it->data;
+        d->mtime = 0;
+        d->files = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, NULL);
+        it->data = d;
+    }
+    p->exec_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          g_free, NULL);
 
     return p;
 }
@@ -233,12 +275,18 @@ void obt_paths_unref(ObtPaths *p)
         for (it = p->autostart_dirs; it; it = g_slist_next(it))
             g_free(it->data);
         g_slist_free(p->autostart_dirs);
-        for (it = p->exec_dirs; it; it = g_slist_next(it))
-            g_free(it->data);
+        for (it = p->exec_dirs; it; it = g_slist_next(it)) {
+            ObtPathsExecDir *d = it->data;
+            g_free(d->path);
+            g_hash_table_destroy(d->files);
+            g_slice_free(ObtPathsExecDir, d);
+        }
         g_slist_free(p->exec_dirs);
+        g_hash_table_destroy(p->exec_cache);
         g_free(p->config_home);
         g_free(p->data_home);
         g_free(p->cache_home);
+        g_free(p->runtime_dir);
         g_free(p->gid);
 
         g_slice_free(ObtPaths, p);
@@ -316,6 +364,11 @@ const gchar* obt_paths_cache_home(ObtPaths *p)
     return p->cache_home;
 }
 
+const gchar* obt_paths_runtime_dir(ObtPaths *p)
+{
+    return p->runtime_dir;
+}
+
 GSList* obt_paths_config_dirs(ObtPaths *p)
 {
     return p->config_dirs;
@@ -350,21 +403,120 @@ static inline gboolean try_exec(const ObtPaths *const p,
     return st.st_mode & S_IXOTH;
 }
 
+/*! Read the names of the files in the directory again if it has changed.
+  Returns TRUE if it had changed. */
+static gboolean exec_dir_update(ObtPathsExecDir *d, time_t now)
+{
+    struct stat st;
+    GDir *dir;
+    const gchar *name;
+
+    if (stat(d->path, &st) != 0) {
+        /* the directory is gone (or was never there) */
+        if (d->mtime == 0 && g_hash_table_size(d->files) == 0)
+            return FALSE;
+        g_hash_table_remove_all(d->files);
+        d->mtime = 0;
+        return TRUE;
+    }
+    if (d->mtime && d->mtime == st.st_mtime)
+        return FALSE;
+
+    g_hash_table_remove_all(d->files);
+    if ((dir = g_dir_open(d->path, 0, NULL))) {
+        while ((name = g_dir_read_name(dir)))
+            g_hash_table_insert(d->files, g_strdup(name),
+                                GINT_TO_POINTER(EXEC_UNKNOWN));
+        g_dir_close(dir);
+    }
+
+    /* the mtime only has a resolution of seconds, so if the directory was
+       changed this second, it could change again without the mtime
+       changing.  read it again the next time to be sure. */
+    d->mtime = st.st_mtime < now ? st.st_mtime : 0;
+    return TRUE;
+}
+
+static void exec_dirs_update(ObtPaths *p)
+{
+    GSList *it;
+    gboolean changed;
+    const time_t now = time(NULL);
+
+    if (p->exec_checked && now >= p->exec_checked &&
+        now - p->exec_checked < EXEC_CHECK_INTERVAL)
+        return;
+    p->exec_checked = now;
+
+    changed = FALSE;
+    for (it = p->exec_dirs; it; it = g_slist_next(it))
+        if (exec_dir_update(it->data, now))
+            changed = TRUE;
+
+    if (changed)
+        g_hash_table_remove_all(p->exec_cache);
+}
+
+static gboolean try_exec_in_dirs(ObtPaths *p, const gchar *name)
+{
+    GSList *it;
+
+    for (it = p->exec_dirs; it; it = g_slist_next(it)) {
+        ObtPathsExecDir *d = it->data;
+        gpointer value;
+        ObtPathsExecState e;
+
+        /* skip the directories which don't have the file at all */
+        if (!(value = g_hash_table_lookup(d->files, name)))
+            continue;
+
+        e = GPOINTER_TO_INT(value);
+        if (e == EXEC_UNKNOWN) {
+            gchar *f = g_build_filename(d->path, name, NULL);
+            e = try_exec(p, f) ? EXEC_YES : EXEC_NO;
+            g_free(f);
+            /* the table keeps its own key and frees this one */
+            g_hash_table_insert(d->files, g_strdup(name), GINT_TO_POINTER(e));
+        }
+        if (e == EXEC_YES)
+            return TRUE;
+    }
+    return FALSE;
+}
+
 gboolean obt_paths_try_exec(ObtPaths *p, const gchar *path)
 {
     if (path[0] == '/') {
         return try_exec(p, path);
     }
-    else {
+    else if (strchr(path, '/')) {
+        /* the file is in a subdirectory, which we don't keep track of */
         GSList *it;
 
         for (it = p->exec_dirs; it; it = g_slist_next(it)) {
-            gchar *f = g_build_filename(it->data, path, NULL);
+            ObtPathsExecDir *d = it->data;
+            gchar *f = g_build_filename(d->path, path, NULL);
             gboolean e = try_exec(p, f);
             g_free(f);
             if (e) return TRUE;
         }
     }
+    else {
+        gpointer value;
+        ObtPathsExecState e;
+
+        exec_dirs_update(p);
+
+        value = g_hash_table_lookup(p->exec_cache, path);
+        if (value)
+            e = GPOINTER_TO_INT(value);
+        else {
+            e = try_exec_in_dirs(p, path) ? EXEC_YES : EXEC_NO;
+            g_hash_table_insert(p->exec_cache, g_strdup(path),
+                                GINT_TO_POINTER(e));
+        }
+        return e == EXEC_YES;
+    }
 
     return FALSE;
 }
@@ -32,6 +32,8 @@ void obt_paths_unref(ObtPaths *p);
 const gchar* obt_paths_config_home(ObtPaths *p);
 const gchar* obt_paths_data_home(ObtPaths *p);
 const gchar* obt_paths_cache_home(ObtPaths *p);
+/*! Returns $XDG_RUNTIME_DIR, or NULL if it is not set */
+const gchar* obt_paths_runtime_dir(ObtPaths *p);
 GSList* obt_paths_config_dirs(ObtPaths *p);
 GSList* obt_paths_data_dirs(ObtPaths *p);
 GSList* obt_paths_autostart_dirs(ObtPaths *p);
@@ -42,6 +44,8 @@ gboolean obt_paths_mkdir_path(const gchar *path, gint mode);
 
 /*! Returns TRUE if the @path points to an executable file.
   If the @path is not an absolute path, then it is searched for in $PATH.
+  The files in $PATH are remembered, and the answer is cached until one of
+  the directories in $PATH changes.
 */
 gboolean obt_paths_try_exec(ObtPaths *p, const gchar *path);
 
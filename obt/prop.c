@@ -19,6 +19,7 @@
 
 #include "obt/prop.h"
 #include "obt/display.h"
+#include "obt/xqueue.h"
 
 #include <X11/Xatom.h>
 #ifdef HAVE_STRING_H
@@ -193,6 +194,7 @@ void obt_prop_startup(void)
     CREATE_(OB_WM_STATE_UNDECORATED);
     CREATE_(OB_CONTROL);
     CREATE_(OB_VERSION);
+    CREATE_(OB_IPC_SOCKET);
     CREATE_(OB_APP_ROLE);
     CREATE_(OB_APP_TITLE);
     CREATE_(OB_APP_NAME);
@@ -209,40 +211,258 @@ Atom obt_prop_atom(ObtPropAtom a)
     return prop_atoms[a];
 }
 
+/*! The raw value of a window property, as XGetWindowProperty returns it */
+typedef struct _ObtPropRaw {
+    Atom type; /*!< None if the property does not exist */
+    gint format;
+    gulong nitems;
+    guchar *data;
+    /*! TRUE if the data belongs to the caller and must be released with
+      release_raw(), FALSE if it belongs to the cache */
+    gboolean owned;
+} ObtPropRaw;
+
+/*! Values larger than this are not kept in the cache, so that big icons do
+  not pin memory for every window */
+#define CACHE_MAX_BYTES (64 * 1024)
+
+typedef struct _ObtPropCacheWindow {
+    Window window;
+    GHashTable *props; /*!< Atom -> ObtPropRaw* */
+} ObtPropCacheWindow;
+
+/*! Maps Window -> ObtPropCacheWindow*, for windows whose properties may be
+  cached */
+static GHashTable *cache_windows = NULL;
+static gboolean cache_verify = FALSE;
+static guint cache_hits = 0;
+static guint cache_misses = 0;
+
+static guint window_hash(Window *w) { return *w; }
+static gboolean window_comp(Window *w1, Window *w2) { return *w1 == *w2; }
+
+static void release_raw(ObtPropRaw *raw)
+{
+    if (raw->owned && raw->data)
+        XFree(raw->data);
+    raw->data = NULL;
+    raw->owned = FALSE;
+}
+
+static void cache_raw_free(gpointer data)
+{
+    ObtPropRaw *raw = data;
+    raw->owned = TRUE;
+    release_raw(raw);
+    g_slice_free(ObtPropRaw, raw);
+}
+
+static void cache_window_free(gpointer data)
+{
+    ObtPropCacheWindow *cw = data;
+    g_hash_table_destroy(cw->props);
+    g_slice_free(ObtPropCacheWindow, cw);
+}
+
+static gsize raw_size(const ObtPropRaw *raw)
+{
+    switch (raw->format) {
+    case 32: return raw->nitems * sizeof(glong);
+    case 16: return raw->nitems * sizeof(gshort);
+    default: return raw->nitems;
+    }
+}
+
+static gboolean raw_equal(const ObtPropRaw *a, const ObtPropRaw *b)
+{
+    return a->type == b->type && a->format == b->format &&
+        a->nitems == b->nitems &&
+        (raw_size(a) == 0 || memcmp(a->data, b->data, raw_size(a)) == 0);
+}
+
+static ObtPropCacheWindow* cache_find_window(Window win)
+{
+    return cache_windows ? g_hash_table_lookup(cache_windows, &win) : NULL;
+}
+
+static void cache_invalidate(Window win, Atom prop)
+{
+    ObtPropCacheWindow *cw = cache_find_window(win);
+    if (cw) g_hash_table_remove(cw->props, GUINT_TO_POINTER(prop));
+}
+
+/*! Read the whole property from the server */
+static gboolean fetch_raw(Window win, Atom prop, ObtPropRaw *raw)
+{
+    gulong bytes_left;
+    gint res;
+
+    raw->data = NULL;
+    raw->owned = FALSE;
+    res = XGetWindowProperty(obt_display, win, prop, 0l, G_MAXLONG,
+                             FALSE, AnyPropertyType, &raw->type, &raw->format,
+                             &raw->nitems, &bytes_left, &raw->data);
+    if (res != Success) {
+        raw->data = NULL;
+        return FALSE;
+    }
+    raw->owned = TRUE;
+    if (raw->type == None) raw->nitems = 0;
+    return TRUE;
+}
+
+/*! Compare a cached value against the server.  A difference is only
+  reported if the PropertyNotify that should have invalidated the value has
+  not reached us either, since a change that is still on its way to us is
+  not an error.  When they differ, @raw is replaced by the server's value and
+  the cached one is dropped.
+*/
+static void cache_verify_hit(Window win, Atom prop, ObtPropRaw *raw)
+{
+    ObtPropRaw fresh;
+    ObtPropCacheWindow *cw;
+
+    if (!fetch_raw(win, prop, &fresh))
+        return; /* keep returning the cached value */
+
+    if (raw_equal(raw, &fresh)) {
+        release_raw(&fresh);
+        return;
+    }
+
+    /* the reply has arrived, so any PropertyNotify sent before it is queued
+       in Xlib now.  read them, which drops the value if the change was
+       already announced */
+    xqueue_read_pending();
+    if ((cw = cache_find_window(win)) &&
+        g_hash_table_lookup(cw->props, GUINT_TO_POINTER(prop)))
+    {
+        gchar *name = XGetAtomName(obt_display, prop);
+        g_warning("Property cache is incoherent for %s on window 0x%lx",
+                  name, win);
+        XFree(name);
+        cache_invalidate(win, prop);
+    }
+    *raw = fresh;
+}
+
+/*! Read a property, from the cache when possible.  The value must be released
+  with release_raw() when the caller is done with it. */
+static gboolean get_raw(Window win, Atom prop, ObtPropRaw *raw)
+{
+    ObtPropCacheWindow *cw;
+    ObtPropRaw *c;
+
+    raw->data = NULL;
+    raw->owned = FALSE;
+
+    cw = cache_find_window(win);
+    if (cw && (c = g_hash_table_lookup(cw->props, GUINT_TO_POINTER(prop)))) {
+        ++cache_hits;
+        *raw = *c;
+        raw->owned = FALSE;
+        if (!cache_verify)
+            return TRUE;
+        cache_verify_hit(win, prop, raw);
+        if (!raw->owned)
+            return TRUE;
+        /* the cached value was wrong, store the server's value below */
+        cw = cache_find_window(win);
+    }
+    else {
+        if (cw) ++cache_misses;
+        if (!fetch_raw(win, prop, raw))
+            return FALSE;
+    }
+
+    if (cw && raw_size(raw) <= CACHE_MAX_BYTES) {
+        c = g_slice_dup(ObtPropRaw, raw);
+        g_hash_table_replace(cw->props, GUINT_TO_POINTER(prop), c);
+        raw->owned = FALSE; /* the cache owns it now */
+    }
+    return TRUE;
+}
+
+void obt_prop_cache_watch(Window win)
+{
+    ObtPropCacheWindow *cw;
+
+    if (!cache_windows)
+        cache_windows = g_hash_table_new_full((GHashFunc)window_hash,
+                                              (GEqualFunc)window_comp,
+                                              NULL, cache_window_free);
+    if (cache_find_window(win)) return;
+
+    cw = g_slice_new(ObtPropCacheWindow);
+    cw->window = win;
+    cw->props = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      NULL, cache_raw_free);
+    g_hash_table_insert(cache_windows, &cw->window, cw);
+}
+
+void obt_prop_cache_unwatch(Window win)
+{
+    if (cache_windows)
+        g_hash_table_remove(cache_windows, &win);
+}
+
+void obt_prop_cache_set_verify(gboolean verify)
+{
+    cache_verify = verify;
+}
+
+void obt_prop_cache_stats(guint *hits, guint *misses)
+{
+    if (hits) *hits = cache_hits;
+    if (misses) *misses = cache_misses;
+}
+
+void obt_prop_cache_event(const XEvent *e)
+{
+    if (!cache_windows) return;
+
+    if (e->type == PropertyNotify)
+        cache_invalidate(e->xproperty.window, e->xproperty.atom);
+    else if (e->type == DestroyNotify)
+        obt_prop_cache_unwatch(e->xdestroywindow.window);
+}
+
+void obt_prop_cache_shutdown(void)
+{
+    if (cache_windows) {
+        g_hash_table_destroy(cache_windows);
+        cache_windows = NULL;
+    }
+}
+
 static gboolean get_prealloc(Window win, Atom prop, Atom type, gint size,
                              guchar *data, gulong num)
 {
     gboolean ret = FALSE;
-    gint res;
-    guchar *xdata = NULL;
-    Atom ret_type;
-    gint ret_size;
-    gulong ret_items, bytes_left;
-    glong num32 = 32 / size * num; /* num in 32-bit elements */
-
-    res = XGetWindowProperty(obt_display, win, prop, 0l, num32,
-                             FALSE, type, &ret_type, &ret_size,
-                             &ret_items, &bytes_left, &xdata);
-    if (res == Success && ret_items && xdata) {
-        if (ret_size == size && ret_items >= num) {
+    ObtPropRaw raw;
+
+    if (get_raw(win, prop, &raw)) {
+        if (raw.type == type && raw.format == size && raw.nitems >= num &&
+            raw.data)
+        {
             guint i;
             for (i = 0; i < num; ++i)
                 switch (size) {
                 case 8:
-                    data[i] = xdata[i];
+                    data[i] = raw.data[i];
                     break;
                 case 16:
-                    ((guint16*)data)[i] = ((gushort*)xdata)[i];
+                    ((guint16*)data)[i] = ((gushort*)raw.data)[i];
                     break;
                 case 32:
-                    ((guint32*)data)[i] = ((gulong*)xdata)[i];
+                    ((guint32*)data)[i] = ((gulong*)raw.data)[i];
                     break;
                 default:
                     g_assert_not_reached(); /* unhandled size */
                 }
             ret = TRUE;
         }
-        XFree(xdata);
+        release_raw(&raw);
     }
     return ret;
 }
@@ -251,38 +471,31 @@ static gboolean get_all(Window win, Atom prop, Atom type, gint size,
                         guchar **data, guint *num)
 {
     gboolean ret = FALSE;
-    gint res;
-    guchar *xdata = NULL;
-    Atom ret_type;
-    gint ret_size;
-    gulong ret_items, bytes_left;
+    ObtPropRaw raw;
 
-    res = XGetWindowProperty(obt_display, win, prop, 0l, G_MAXLONG,
-                             FALSE, type, &ret_type, &ret_size,
-                             &ret_items, &bytes_left, &xdata);
-    if (res == Success) {
-        if (ret_size == size && ret_items > 0) {
+    if (get_raw(win, prop, &raw)) {
+        if (raw.type == type && raw.format == size && raw.nitems > 0) {
             guint i;
 
-            *data = g_malloc(ret_items * (size / 8));
-            for (i = 0; i < ret_items; ++i)
+            *data = g_malloc(raw.nitems * (size / 8));
+            for (i = 0; i < raw.nitems; ++i)
                 switch (size) {
                 case 8:
-                    (*data)[i] = xdata[i];
+                    (*data)[i] = raw.data[i];
                     break;
                 case 16:
-                    ((guint16*)*data)[i] = ((gushort*)xdata)[i];
+                    ((guint16*)*data)[i] = ((gushort*)raw.data)[i];
                     break;
                 case 32:
-                    ((guint32*)*data)[i] = ((gulong*)xdata)[i];
+                    ((guint32*)*data)[i] = ((gulong*)raw.data)[i];
                     break;
                 default:
                     g_assert_not_reached(); /* unhandled size */
                 }
-            *num = ret_items;
+            *num = raw.nitems;
             ret = TRUE;
         }
-        XFree(xdata);
+        release_raw(&raw);
     }
     return ret;
 }
@@ -293,14 +506,21 @@ static gboolean get_all(Window win, Atom prop, Atom type, gint size,
   @param tprop The XTextProperty to fill out.
   @param type 0 to get text of any type, or a value from
     ObtPropTextType to restrict the value to a specific type.
+  @param raw The value backing the XTextProperty, which must be released with
+    release_raw() when the XTextProperty is no longer used.
   @return TRUE if the text was read and validated against the @type, and FALSE
     otherwise.
 */
 static gboolean get_text_property(Window win, Atom prop,
-                                  XTextProperty *tprop, ObtPropTextType type)
+                                  XTextProperty *tprop, ObtPropTextType type,
+                                  ObtPropRaw *raw)
 {
-    if (!(XGetTextProperty(obt_display, win, tprop, prop) && tprop->nitems))
+    if (!(get_raw(win, prop, raw) && raw->type != None && raw->nitems))
         return FALSE;
+    tprop->value = raw->data;
+    tprop->encoding = raw->type;
+    tprop->format = raw->format;
+    tprop->nitems = raw->nitems;
     if (!type)
         return TRUE; /* no type checking */
     switch (type) {
@@ -485,10 +705,11 @@ gboolean obt_prop_get_text(Window win, Atom prop, ObtPropTextType type,
                            gchar **ret_string)
 {
     XTextProperty tprop;
+    ObtPropRaw raw;
     gchar *str;
     gboolean ret = FALSE;
 
-    if (get_text_property(win, prop, &tprop, type)) {
+    if (get_text_property(win, prop, &tprop, type, &raw)) {
         str = (gchar*)convert_text_property(&tprop, type, 1);
 
         if (str) {
@@ -496,7 +717,7 @@ gboolean obt_prop_get_text(Window win, Atom prop, ObtPropTextType type,
             ret = TRUE;
         }
     }
-    XFree(tprop.value);
+    release_raw(&raw);
     return ret;
 }
 
@@ -505,10 +726,11 @@ gboolean obt_prop_get_array_text(Window win, Atom prop,
                                  gchar ***ret_strings)
 {
     XTextProperty tprop;
+    ObtPropRaw raw;
     gchar **strs;
     gboolean ret = FALSE;
 
-    if (get_text_property(win, prop, &tprop, type)) {
+    if (get_text_property(win, prop, &tprop, type, &raw)) {
         strs = (gchar**)convert_text_property(&tprop, type, -1);
 
         if (strs) {
@@ -516,14 +738,41 @@ gboolean obt_prop_get_array_text(Window win, Atom prop,
             ret = TRUE;
         }
     }
-    XFree(tprop.value);
+    release_raw(&raw);
     return ret;
 }
 
+XWMHints* obt_prop_get_wmhints(Window win)
+{
+    XWMHints *hints = NULL;
+    ObtPropRaw raw;
+
+    /* this decodes the property the same way as XGetWMHints() */
+    if (get_raw(win, XA_WM_HINTS, &raw)) {
+        if (raw.type == XA_WM_HINTS && raw.format == 32 && raw.nitems >= 8) {
+            const glong *d = (glong*)raw.data;
+
+            hints = XAllocWMHints();
+            hints->flags = d[0];
+            hints->input = d[1] ? True : False;
+            hints->initial_state = d[2];
+            hints->icon_pixmap = d[3];
+            hints->icon_window = d[4];
+            hints->icon_x = d[5];
+            hints->icon_y = d[6];
+            hints->icon_mask = d[7];
+            hints->window_group = raw.nitems >= 9 ? d[8] : None;
+        }
+        release_raw(&raw);
+    }
+    return hints;
+}
+
 void obt_prop_set32(Window win, Atom prop, Atom type, gulong val)
 {
     XChangeProperty(obt_display, win, prop, type, 32, PropModeReplace,
                     (guchar*)&val, 1);
+    cache_invalidate(win, prop);
 }
 
 void obt_prop_set_array32(Window win, Atom prop, Atom type, gulong *val,
@@ -531,12 +780,14 @@ void obt_prop_set_array32(Window win, Atom prop, Atom type, gulong *val,
 {
     XChangeProperty(obt_display, win, prop, type, 32, PropModeReplace,
                     (guchar*)val, num);
+    cache_invalidate(win, prop);
 }
 
 void obt_prop_set_text(Window win, Atom prop, const gchar *val)
 {
     XChangeProperty(obt_display, win, prop, OBT_PROP_ATOM(UTF8_STRING), 8,
                     PropModeReplace, (const guchar*)val, strlen(val));
+    cache_invalidate(win, prop);
 }
 
 void obt_prop_set_array_text(Window win, Atom prop, const gchar *const *strs)
@@ -552,11 +803,13 @@ void obt_prop_set_array_text(Window win, Atom prop, const gchar *const *strs)
     XChangeProperty(obt_display, win, prop, OBT_PROP_ATOM(UTF8_STRING), 8,
                     PropModeReplace, (guchar*)str->str, str->len);
     g_string_free(str, TRUE);
+    cache_invalidate(win, prop);
 }
 
 void obt_prop_erase(Window win, Atom prop)
 {
     XDeleteProperty(obt_display, win, prop);
+    cache_invalidate(win, prop);
 }
 
 void obt_prop_message(gint screen, Window about, Atom messagetype,
@@ -21,6 +21,7 @@
 #define __obt_prop_h
 
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <glib.h>
 
 G_BEGIN_DECLS
@@ -215,6 +216,7 @@ typedef enum {
     OBT_PROP_OB_CONFIG_FILE,
     OBT_PROP_OB_CONTROL,
     OBT_PROP_OB_VERSION,
+    OBT_PROP_OB_IPC_SOCKET,
     OBT_PROP_OB_APP_ROLE,
     OBT_PROP_OB_APP_TITLE,
     OBT_PROP_OB_APP_NAME,
@@ -256,6 +258,10 @@ gboolean obt_prop_get_array_text(Window win, Atom prop,
                                  ObtPropTextType type,
                                  gchar ***ret);
 
+/*! Read the WM_HINTS property like XGetWMHints() does, but through the
+  property cache.  Free the result with XFree(). */
+XWMHints* obt_prop_get_wmhints(Window win);
+
 void obt_prop_set32(Window win, Atom prop, Atom type, gulong val);
 void obt_prop_set_array32(Window win, Atom prop, Atom type, gulong *val,
                           guint num);
@@ -271,6 +277,21 @@ void obt_prop_message_to(Window to, Window about, Atom messagetype,
                          glong data0, glong data1, glong data2, glong data3,
                          glong data4, glong mask);
 
+/*! Begin caching the properties of a window.  Reads of the window's
+  properties are then served from memory until a PropertyNotify for the
+  property, or a DestroyNotify for the window, arrives.  The caller must have
+  selected PropertyChangeMask on the window, or the cache will go stale. */
+void obt_prop_cache_watch(Window win);
+/*! Stop caching the properties of a window, and forget the cached values */
+void obt_prop_cache_unwatch(Window win);
+/*! When enabled, every cache hit is also read from the server and compared
+  with the cached value, and a warning is shown if they do not agree.  This is
+  for debugging, as it makes every read a round trip again. */
+void obt_prop_cache_set_verify(gboolean verify);
+/*! Returns the number of reads for watched windows that were served from the
+  cache, and the number that had to go to the server */
+void obt_prop_cache_stats(guint *hits, guint *misses);
+
 #define OBT_PROP_ATOM(prop) obt_prop_atom(OBT_PROP_##prop)
 
 #define OBT_PROP_GET32(win, prop, type, ret) \
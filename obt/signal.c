@@ -30,6 +30,13 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
+#ifdef HAVE_SYS_SIGNALFD_H
+#  include <sys/signalfd.h>
+#  define USE_SIGNALFD
+#endif
+#ifdef HAVE_ERRNO_H
+#  include <errno.h>
+#endif
 
 typedef struct _ObtSignalCallback ObtSignalCallback;
 
@@ -81,7 +88,23 @@ static GSourceFuncs source_funcs = {
     signal_occurred,
     NULL
 };
+
+struct signal_source {
+    GSource source;
+
+    GPollFD pfd;
+};
+
 static GSource *gsource = NULL;
+#ifdef USE_SIGNALFD
+/* when this is open, the signals with callbacks are blocked and read from it
+   instead of going through sighandler */
+static gint signal_fd = -1;
+/* the signals which are blocked and read from the signal_fd */
+static sigset_t fd_signals_set;
+#endif
+/* the signal mask from before we started blocking signals, for children */
+static sigset_t orig_signals_set;
 static guint listeners = 0; /* a ref count for the signal listener */
 static gboolean signal_fired;
 guint signals_fired[NUM_SIGNALS];
@@ -115,9 +138,24 @@ void obt_signal_listen(void)
             }
         }
 
-        gsource = g_source_new(&source_funcs, sizeof(GSource));
+        sigprocmask(SIG_SETMASK, NULL, &orig_signals_set);
+
+        gsource = g_source_new(&source_funcs, sizeof(struct signal_source));
         g_source_set_priority(gsource, G_PRIORITY_HIGH);
 
+#ifdef USE_SIGNALFD
+        /* if the kernel doesn't have signalfd, then fall back to using
+           sighandler for everything */
+        sigemptyset(&fd_signals_set);
+        signal_fd = signalfd(-1, &fd_signals_set, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (signal_fd >= 0) {
+            struct signal_source *s = (struct signal_source *)gsource;
+
+            s->pfd = (GPollFD){ signal_fd, G_IO_IN, 0 };
+            g_source_add_poll(gsource, &s->pfd);
+        }
+#endif
+
         g_source_attach(gsource, NULL);
     }
 
@@ -132,6 +170,7 @@ void obt_signal_stop(void)
         gint i;
         GSList *it, *next;
 
+        g_source_destroy(gsource);
         g_source_unref(gsource);
         gsource = NULL;
 
@@ -143,6 +182,13 @@ void obt_signal_stop(void)
                 obt_signal_remove_callback(i, cb->func);
             }
 
+#ifdef USE_SIGNALFD
+        if (signal_fd >= 0) {
+            close(signal_fd);
+            signal_fd = -1;
+        }
+#endif
+
         /* release all the signals that cause core dumps */
         for (i = 0; i < NUM_CORE_SIGNALS; ++i) {
             if (all_signals[core_signals[i]].installed) {
@@ -159,6 +205,46 @@ void obt_signal_stop(void)
     }
 }
 
+void obt_signal_child_setup(gpointer data)
+{
+    /* the blocked signals would stay blocked across exec() */
+    if (listeners)
+        sigprocmask(SIG_SETMASK, &orig_signals_set, NULL);
+}
+
+static gboolean use_signal_fd(void)
+{
+#ifdef USE_SIGNALFD
+    return signal_fd >= 0;
+#else
+    return FALSE;
+#endif
+}
+
+/*! Start or stop reading a signal from the signal_fd */
+static void watch_signal_fd(gint sig, gboolean watch)
+{
+#ifdef USE_SIGNALFD
+    sigset_t sigset;
+
+    sigemptyset(&sigset);
+    sigaddset(&sigset, sig);
+
+    if (watch) {
+        /* the signal must be blocked before the fd will see it */
+        sigaddset(&fd_signals_set, sig);
+        sigprocmask(SIG_BLOCK, &sigset, NULL);
+        signalfd(signal_fd, &fd_signals_set, 0);
+    }
+    else {
+        sigdelset(&fd_signals_set, sig);
+        signalfd(signal_fd, &fd_signals_set, 0);
+        if (!sigismember(&orig_signals_set, sig))
+            sigprocmask(SIG_UNBLOCK, &sigset, NULL);
+    }
+#endif
+}
+
 void obt_signal_add_callback(gint sig, ObtSignalHandler func, gpointer data)
 {
     ObtSignalCallback *cb;
@@ -175,7 +261,9 @@ void obt_signal_add_callback(gint sig, ObtSignalHandler func, gpointer data)
     callbacks[sig] = g_slist_prepend(callbacks[sig], cb);
 
     /* install the signal handler */
-    if (!all_signals[sig].installed) {
+    if (!all_signals[sig].installed && use_signal_fd())
+        watch_signal_fd(sig, TRUE);
+    else if (!all_signals[sig].installed) {
         struct sigaction action;
         sigset_t sigset;
 
@@ -210,7 +298,9 @@ void obt_signal_remove_callback(gint sig, ObtSignalHandler func)
 
             /* uninstall the signal handler */
             all_signals[sig].installed--;
-            if (!all_signals[sig].installed)
+            if (!all_signals[sig].installed && use_signal_fd())
+                watch_signal_fd(sig, FALSE);
+            else if (!all_signals[sig].installed)
                 sigaction(sig, &all_signals[sig].oldact, NULL);
             break;
         }
@@ -225,7 +315,32 @@ static gboolean signal_prepare(GSource *source, gint *timeout)
 
 static gboolean signal_check(GSource *source)
 {
-    return signal_fired;
+    const struct signal_source *s = (const struct signal_source *)source;
+
+    return signal_fired || (s->pfd.revents & G_IO_IN);
+}
+
+/*! Read all of the signals waiting in the signal_fd */
+static void read_signal_fd(guint *fired)
+{
+#ifdef USE_SIGNALFD
+    struct signalfd_siginfo info[16];
+    ssize_t r;
+    guint i, n;
+
+    do {
+        r = read(signal_fd, info, sizeof(info));
+        n = r > 0 ? r / sizeof(info[0]) : 0;
+        for (i = 0; i < n; ++i)
+            if (info[i].ssi_signo < NUM_SIGNALS)
+                ++fired[info[i].ssi_signo];
+    } while (n == G_N_ELEMENTS(info) || (r < 0 && errno == EINTR));
+
+    /* children exiting together are reported as a single SIGCHLD, the
+       callbacks have to reap everything that has exited anyways */
+    if (fired[SIGCHLD] > 1)
+        fired[SIGCHLD] = 1;
+#endif
 }
 
 static gboolean signal_occurred(GSource *source, GSourceFunc callback,
@@ -248,6 +363,9 @@ static gboolean signal_occurred(GSource *source, GSourceFunc callback,
 
     sigprocmask(SIG_SETMASK, &oldset, NULL);
 
+    if (use_signal_fd())
+        read_signal_fd(fired);
+
     /* call the signal callbacks for the signals */
     for (i = 0; i < NUM_SIGNALS; ++i) {
         while (fired[i]) {
@@ -27,6 +27,8 @@ typedef void (*ObtSignalHandler)(gint signal, gpointer data);
 
 /*! Listen for signals and report them through the default GMainContext within
    main program thread (except signals that require immediate exit).
+   Where signalfd is available, the signals with callbacks are blocked and
+   read from a single file descriptor instead of using a signal handler.
    The app should not set its own signal handler function or it will interfere
    with this one. */
 void obt_signal_listen(void);
@@ -41,6 +43,11 @@ void obt_signal_add_callback(gint sig, ObtSignalHandler func, gpointer data);
 /*! Removes the most recently added callback with the given function. */
 void obt_signal_remove_callback(gint sig, ObtSignalHandler func);
 
+/*! Signals with callbacks may be blocked while listening, and the blocked
+  signals are inherited by child processes.  Pass this as the child_setup
+  function when spawning processes to give them the original signal mask. */
+void obt_signal_child_setup(gpointer data);
+
 G_END_DECLS
 
 #endif
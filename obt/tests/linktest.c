@@ -25,21 +25,38 @@ exit
    See the COPYING file for a copy of the GNU General Public License.
 */
 
-#include "obt/linkbase.h"
+#include "obt/linkindex.h"
 #include "obt/paths.h"
+#include "obt/watch.h"
 #include <glib.h>
-#include <locale.h>
+#include <stdio.h>
+
+static void print_app(const ObtLinkIndexApp *a, gpointer data)
+{
+    printf("%s: %s (%s)\n", a->id, a->name, a->exec);
+}
+
+static void changed(ObtLinkIndex *i, gpointer data)
+{
+    printf("changed\n");
+    obt_linkindex_foreach(i, print_app, NULL);
+}
 
 gint main()
 {
-    ObtLinkBase *base;
+    ObtLinkIndex *index;
     ObtPaths *paths;
+    ObtWatch *watch;
     GMainLoop *loop;
 
     paths = obt_paths_new();
-    base = obt_linkbase_new(paths, setlocale(LC_MESSAGES, ""));
+    index = obt_linkindex_new(paths);
+    obt_linkindex_foreach(index, print_app, NULL);
     printf("done\n");
-    return 0;
+
+    watch = obt_watch_new();
+    obt_watch_set_delay(watch, 500);
+    obt_linkindex_watch(index, watch, changed, NULL);
 
     loop = g_main_loop_new(NULL, FALSE);
     g_main_loop_run(loop);
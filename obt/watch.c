@@ -0,0 +1,538 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/watch.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "obt/watch.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#  include <sys/inotify.h>
+#  include <limits.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#  include <errno.h>
+#endif
+
+typedef struct _ObtWatchTarget ObtWatchTarget;
+typedef struct _ObtWatchDir ObtWatchDir;
+typedef struct _ObtWatchUser ObtWatchUser;
+typedef struct _ObtWatchNotify ObtWatchNotify;
+
+/*! A path given to obt_watch_add() */
+struct _ObtWatchTarget {
+    ObtWatch *w;
+    gchar *path;
+    /*! The name of the file when watching a file, or NULL when watching a
+      directory */
+    gchar *file;
+    gboolean recursive;
+    ObtWatchFunc func;
+    gpointer data;
+};
+
+/*! A directory watched by inotify.  When watching a file, its directory is
+  watched instead, so that the file can be replaced or created. */
+struct _ObtWatchDir {
+    gint wd;
+    gchar *path;
+    /*! The ObtWatchUsers which this directory is being watched for */
+    GSList *users;
+};
+
+struct _ObtWatchUser {
+    ObtWatchTarget *target;
+    /*! The path of the directory relative to the target's path, which is
+      empty for the target's own directory */
+    gchar *subdir;
+};
+
+/*! A change which has not been reported yet */
+struct _ObtWatchNotify {
+    gchar *base_path;
+    gchar *subpath;
+    ObtWatchNotifyType type;
+};
+
+struct _ObtWatch {
+    gint ref;
+    gint fd;
+    GSource *source;
+    /*! Maps the path of each target to its ObtWatchTarget */
+    GHashTable *targets;
+    /*! Maps inotify watch descriptors to their ObtWatchDir */
+    GHashTable *dirs;
+    guint delay;
+    guint delay_id;
+    /*! The ObtWatchNotify changes to report, the newest first */
+    GSList *pending;
+};
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                    IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+                    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+typedef struct _ObtWatchSource {
+    GSource source;
+
+    GPollFD pfd;
+    ObtWatch *w;
+} ObtWatchSource;
+
+static gboolean watch_prepare(GSource *source, gint *timeout);
+static gboolean watch_check(GSource *source);
+static gboolean watch_dispatch(GSource *source, GSourceFunc callback,
+                               gpointer data);
+
+static GSourceFuncs watch_source_funcs = {
+    watch_prepare,
+    watch_check,
+    watch_dispatch,
+    NULL
+};
+
+#endif
+
+static void target_free(ObtWatchTarget *t)
+{
+    g_free(t->path);
+    g_free(t->file);
+    g_slice_free(ObtWatchTarget, t);
+}
+
+static void user_free(ObtWatchUser *u)
+{
+    g_free(u->subdir);
+    g_slice_free(ObtWatchUser, u);
+}
+
+static void dir_free(ObtWatchDir *d)
+{
+    while (d->users) {
+        user_free(d->users->data);
+        d->users = g_slist_delete_link(d->users, d->users);
+    }
+    g_free(d->path);
+    g_slice_free(ObtWatchDir, d);
+}
+
+static void notify_free(ObtWatchNotify *n)
+{
+    g_free(n->base_path);
+    g_free(n->subpath);
+    g_slice_free(ObtWatchNotify, n);
+}
+
+ObtWatch* obt_watch_new(void)
+{
+    ObtWatch *w;
+
+    w = g_slice_new0(ObtWatch);
+    w->ref = 1;
+    w->fd = -1;
+    w->targets = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                       (GDestroyNotify)target_free);
+    w->dirs = g_hash_table_new_full(g_int_hash, g_int_equal, NULL,
+                                    (GDestroyNotify)dir_free);
+
+#ifdef HAVE_SYS_INOTIFY_H
+    w->fd = inotify_init();
+    if (w->fd < 0)
+        g_message("Unable to watch files for changes: %s", g_strerror(errno));
+    else {
+        ObtWatchSource *s;
+
+        fcntl(w->fd, F_SETFD, FD_CLOEXEC);
+        fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) | O_NONBLOCK);
+
+        w->source = g_source_new(&watch_source_funcs, sizeof(ObtWatchSource));
+        s = (ObtWatchSource*)w->source;
+        s->w = w;
+        s->pfd = (GPollFD){ w->fd, G_IO_IN, 0 };
+        g_source_add_poll(w->source, &s->pfd);
+        g_source_attach(w->source, NULL);
+    }
+#endif
+
+    return w;
+}
+
+void obt_watch_ref(ObtWatch *w)
+{
+    ++w->ref;
+}
+
+void obt_watch_unref(ObtWatch *w)
+{
+    if (w && --w->ref < 1) {
+        if (w->delay_id) g_source_remove(w->delay_id);
+        while (w->pending) {
+            notify_free(w->pending->data);
+            w->pending = g_slist_delete_link(w->pending, w->pending);
+        }
+        if (w->source) {
+            g_source_destroy(w->source);
+            g_source_unref(w->source);
+        }
+        /* closing the inotify descriptor removes all of its watches */
+        if (w->fd >= 0) close(w->fd);
+        g_hash_table_destroy(w->dirs);
+        g_hash_table_destroy(w->targets);
+        g_slice_free(ObtWatch, w);
+    }
+}
+
+void obt_watch_set_delay(ObtWatch *w, guint msec)
+{
+    w->delay = msec;
+}
+
+static void flush(ObtWatch *w)
+{
+    GSList *list;
+
+    /* report the oldest changes first.  the callbacks may add or remove
+       paths, or even drop the last reference to the watch */
+    list = g_slist_reverse(w->pending);
+    w->pending = NULL;
+
+    obt_watch_ref(w);
+    while (list) {
+        ObtWatchNotify *n = list->data;
+        ObtWatchTarget *t;
+
+        if ((t = g_hash_table_lookup(w->targets, n->base_path)))
+            t->func(w, n->base_path, n->subpath, n->type, t->data);
+
+        notify_free(n);
+        list = g_slist_delete_link(list, list);
+    }
+    obt_watch_unref(w);
+}
+
+static gboolean delay_func(gpointer data)
+{
+    ObtWatch *w = data;
+
+    w->delay_id = 0;
+    flush(w);
+    return FALSE; /* don't repeat */
+}
+
+static void queue(ObtWatch *w, ObtWatchTarget *t, const gchar *subpath,
+                  ObtWatchNotifyType type)
+{
+    GSList *it;
+    ObtWatchNotify *n;
+
+    /* merge it with a change to the same file which has not been reported */
+    for (it = w->pending; it; it = g_slist_next(it)) {
+        n = it->data;
+        if (!strcmp(n->base_path, t->path) && !strcmp(n->subpath, subpath))
+            break;
+    }
+
+    if (it) {
+        n = it->data;
+        if (n->type == OBT_WATCH_ADDED && type == OBT_WATCH_MODIFIED)
+            ; /* still a new file */
+        else if (n->type == OBT_WATCH_ADDED && type == OBT_WATCH_REMOVED) {
+            /* it came and went, so there is nothing to report */
+            notify_free(n);
+            w->pending = g_slist_delete_link(w->pending, it);
+        }
+        else if (n->type == OBT_WATCH_REMOVED && type == OBT_WATCH_ADDED)
+            /* it was replaced */
+            n->type = OBT_WATCH_MODIFIED;
+        else
+            n->type = type;
+        return;
+    }
+
+    n = g_slice_new(ObtWatchNotify);
+    n->base_path = g_strdup(t->path);
+    n->subpath = g_strdup(subpath);
+    n->type = type;
+    w->pending = g_slist_prepend(w->pending, n);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+static gboolean add_dir(ObtWatch *w, ObtWatchTarget *t, const gchar *path,
+                        const gchar *subdir)
+{
+    ObtWatchDir *d;
+    ObtWatchUser *u;
+    GSList *it;
+    gint wd;
+
+    wd = inotify_add_watch(w->fd, path, WATCH_MASK);
+    if (wd < 0)
+        return FALSE;
+
+    /* the same directory can be watched for more than one target, and
+       inotify gives back the same descriptor for it */
+    if (!(d = g_hash_table_lookup(w->dirs, &wd))) {
+        d = g_slice_new0(ObtWatchDir);
+        d->wd = wd;
+        d->path = g_strdup(path);
+        g_hash_table_insert(w->dirs, &d->wd, d);
+    }
+    for (it = d->users; it; it = g_slist_next(it))
+        if (((ObtWatchUser*)it->data)->target == t)
+            return TRUE; /* already watching it for this target */
+
+    u = g_slice_new(ObtWatchUser);
+    u->target = t;
+    u->subdir = g_strdup(subdir);
+    d->users = g_slist_prepend(d->users, u);
+
+    if (t->file == NULL && t->recursive) {
+        GDir *dir;
+        const gchar *name;
+
+        if ((dir = g_dir_open(path, 0, NULL))) {
+            while ((name = g_dir_read_name(dir))) {
+                gchar *p = g_build_filename(path, name, NULL);
+
+                /* don't follow links, they could make loops */
+                if (g_file_test(p, G_FILE_TEST_IS_DIR) &&
+                    !g_file_test(p, G_FILE_TEST_IS_SYMLINK))
+                {
+                    gchar *s = subdir[0] ?
+                        g_build_filename(subdir, name, NULL) : g_strdup(name);
+                    add_dir(w, t, p, s);
+                    g_free(s);
+                }
+                g_free(p);
+            }
+            g_dir_close(dir);
+        }
+    }
+    return TRUE;
+}
+
+/*! Stop watching directories for the target */
+static gboolean remove_target_dirs(gpointer key, gpointer value,
+                                   gpointer data)
+{
+    ObtWatchDir *d = value;
+    ObtWatchTarget *t = data;
+    GSList *it, *next;
+
+    for (it = d->users; it; it = next) {
+        ObtWatchUser *u = it->data;
+        next = g_slist_next(it);
+        if (u->target == t) {
+            user_free(u);
+            d->users = g_slist_delete_link(d->users, it);
+        }
+    }
+
+    if (d->users == NULL) {
+        /* the watch is gone already if the directory was removed */
+        inotify_rm_watch(t->w->fd, d->wd);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+#endif
+
+gboolean obt_watch_add(ObtWatch *w, const gchar *path, gboolean recursive,
+                       ObtWatchFunc func, gpointer data)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    ObtWatchTarget *t;
+    gboolean ok;
+
+    g_return_val_if_fail(path != NULL, FALSE);
+    g_return_val_if_fail(func != NULL, FALSE);
+
+    if (w->fd < 0) return FALSE;
+
+    obt_watch_remove(w, path);
+
+    t = g_slice_new(ObtWatchTarget);
+    t->w = w;
+    t->path = g_strdup(path);
+    t->recursive = recursive;
+    t->func = func;
+    t->data = data;
+    g_hash_table_insert(w->targets, t->path, t);
+
+    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        t->file = NULL;
+        ok = add_dir(w, t, path, "");
+    }
+    else {
+        gchar *dir = g_path_get_dirname(path);
+        t->file = g_path_get_basename(path);
+        ok = add_dir(w, t, dir, "");
+        g_free(dir);
+    }
+
+    if (!ok)
+        obt_watch_remove(w, path);
+    return ok;
+#else
+    return FALSE;
+#endif
+}
+
+void obt_watch_remove(ObtWatch *w, const gchar *path)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    ObtWatchTarget *t;
+
+    if ((t = g_hash_table_lookup(w->targets, path))) {
+        g_hash_table_foreach_remove(w->dirs, remove_target_dirs, t);
+        g_hash_table_remove(w->targets, path);
+    }
+#endif
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+static void dir_event(ObtWatch *w, ObtWatchDir *d, struct inotify_event *ev)
+{
+    GSList *it;
+    ObtWatchNotifyType type;
+    const gchar *name = ev->len ? ev->name : "";
+
+    if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+        type = OBT_WATCH_ADDED;
+    else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+        type = OBT_WATCH_REMOVED;
+    else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+        type = OBT_WATCH_SELF_REMOVED;
+    else
+        type = OBT_WATCH_MODIFIED;
+
+    for (it = d->users; it; it = g_slist_next(it)) {
+        ObtWatchUser *u = it->data;
+        ObtWatchTarget *t = u->target;
+
+        if (type == OBT_WATCH_SELF_REMOVED) {
+            /* subdirectories being removed are reported by their parent */
+            if (u->subdir[0] == '\0')
+                queue(w, t, "", OBT_WATCH_SELF_REMOVED);
+        }
+        else if (t->file) {
+            if (!strcmp(name, t->file))
+                queue(w, t, "", type);
+        }
+        else {
+            gchar *sub = u->subdir[0] ?
+                g_build_filename(u->subdir, name, NULL) : g_strdup(name);
+
+            queue(w, t, sub, type);
+
+            /* watch new directories inside a recursive watch */
+            if (t->recursive && (ev->mask & IN_ISDIR) &&
+                type == OBT_WATCH_ADDED)
+            {
+                gchar *p = g_build_filename(d->path, name, NULL);
+                add_dir(w, t, p, sub);
+                g_free(p);
+            }
+            g_free(sub);
+        }
+    }
+}
+
+static void queue_lost(gpointer key, gpointer value, gpointer data)
+{
+    queue(data, value, "", OBT_WATCH_MODIFIED);
+}
+
+static void read_events(ObtWatch *w)
+{
+    /* big enough for at least one event with the longest name */
+    gchar buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    gssize len;
+
+    while ((len = read(w->fd, buf, sizeof(buf))) > 0) {
+        gchar *p;
+
+        for (p = buf; p < buf + len;
+             p += sizeof(struct inotify_event) +
+                 ((struct inotify_event*)p)->len)
+        {
+            struct inotify_event *ev = (struct inotify_event*)p;
+            ObtWatchDir *d;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                /* some changes were lost, so say everything changed */
+                g_hash_table_foreach(w->targets, queue_lost, w);
+                continue;
+            }
+
+            if (!(d = g_hash_table_lookup(w->dirs, &ev->wd)))
+                continue;
+
+            if (ev->mask & IN_IGNORED)
+                /* the directory is gone, and so is its watch */
+                g_hash_table_remove(w->dirs, &ev->wd);
+            else
+                dir_event(w, d, ev);
+        }
+    }
+}
+
+static gboolean watch_prepare(GSource *source, gint *timeout)
+{
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean watch_check(GSource *source)
+{
+    ObtWatchSource *s = (ObtWatchSource*)source;
+
+    return s->pfd.revents & G_IO_IN;
+}
+
+static gboolean watch_dispatch(GSource *source, GSourceFunc callback,
+                               gpointer data)
+{
+    ObtWatch *w = ((ObtWatchSource*)source)->w;
+
+    read_events(w);
+
+    if (w->pending) {
+        if (w->delay == 0)
+            flush(w);
+        else if (!w->delay_id)
+            /* collect the changes until the delay is up */
+            w->delay_id = g_timeout_add(w->delay, delay_func, w);
+    }
+
+    return TRUE; /* repeat */
+}
+
+#endif
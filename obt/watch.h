@@ -0,0 +1,70 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/watch.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __obt_watch_h
+#define __obt_watch_h
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ObtWatch ObtWatch;
+
+typedef enum {
+    OBT_WATCH_ADDED,
+    OBT_WATCH_REMOVED,
+    OBT_WATCH_MODIFIED,
+    /*! The watched path itself was removed or moved away, and is not watched
+      anymore */
+    OBT_WATCH_SELF_REMOVED
+} ObtWatchNotifyType;
+
+/*! A function called when a watched path changes.
+  @base_path The path which was given to obt_watch_add().
+  @subpath The path of the file that changed, relative to @base_path.  This is
+    an empty string when @base_path itself changed.
+*/
+typedef void (*ObtWatchFunc)(ObtWatch *w, const gchar *base_path,
+                             const gchar *subpath, ObtWatchNotifyType type,
+                             gpointer data);
+
+/*! Create a new set of watched paths.  Changes to them are reported through
+  the default GMainContext. */
+ObtWatch* obt_watch_new(void);
+void obt_watch_ref(ObtWatch *w);
+void obt_watch_unref(ObtWatch *w);
+
+/*! Watch a file or a directory for changes.
+  When @path is a directory, changes to the files inside it are reported, and
+  when @recursive is TRUE, changes inside all of its subdirectories are as
+  well.  A file does not have to exist yet, as long as its directory does.
+  Returns FALSE if the path can not be watched.
+*/
+gboolean obt_watch_add(ObtWatch *w, const gchar *path, gboolean recursive,
+                       ObtWatchFunc func, gpointer data);
+void obt_watch_remove(ObtWatch *w, const gchar *path);
+
+/*! Wait @msec milliseconds after a change before reporting it, and report all
+  the changes made in that time together.  Many changes to the same file are
+  reported once.  The default is 0, to report every change right away.
+*/
+void obt_watch_set_delay(ObtWatch *w, guint msec);
+
+G_END_DECLS
+
+#endif
@@ -18,8 +18,10 @@
 
 #include "obt/xml.h"
 #include "obt/paths.h"
+#include "obt/internal.h"
 
 #include <libxml/xinclude.h>
+#include <libxml/SAX2.h>
 #include <glib.h>
 
 #ifdef HAVE_STDLIB_H
@@ -51,6 +53,11 @@ struct _ObtXmlInst {
     gchar *last_error_file;
     gint last_error_line;
     gchar *last_error_message;
+
+    /* for parsing a document in pieces */
+    xmlParserCtxtPtr stream;
+    gchar *stream_root;
+    gboolean stream_bad;
 };
 
 static void obt_xml_save_last_error(ObtXmlInst* inst);
@@ -74,6 +81,9 @@ ObtXmlInst* obt_xml_instance_new(void)
     i->last_error_file = NULL;
     i->last_error_line = -1;
     i->last_error_message = NULL;
+    i->stream = NULL;
+    i->stream_root = NULL;
+    i->stream_bad = FALSE;
     return i;
 }
 
@@ -150,12 +160,19 @@ static gboolean load_file(ObtXmlInst *i,
             path = g_build_filename(it->data, domain, filename, NULL);
 
         if (stat(path, &s) >= 0) {
-            /* XML_PARSE_BLANKS is needed apparently, or the tree can end up
-               with extra nodes in it. */
-            i->doc = xmlReadFile(path, NULL, (XML_PARSE_NOBLANKS |
-                                              XML_PARSE_RECOVER));
-            xmlXIncludeProcessFlags(i->doc, (XML_PARSE_NOBLANKS |
-                                             XML_PARSE_RECOVER));
+            gboolean cached;
+
+            /* a document which was parsed before and has not changed is
+               rebuilt from the cache without parsing it */
+            cached = !!(i->doc = obt_xml_cache_load(i->xdg_paths, path));
+            if (!cached) {
+                /* XML_PARSE_BLANKS is needed apparently, or the tree can end
+                   up with extra nodes in it. */
+                i->doc = xmlReadFile(path, NULL, (XML_PARSE_NOBLANKS |
+                                                  XML_PARSE_RECOVER));
+                xmlXIncludeProcessFlags(i->doc, (XML_PARSE_NOBLANKS |
+                                                 XML_PARSE_RECOVER));
+            }
             if (i->doc) {
                 i->root = xmlDocGetRootElement(i->doc);
                 if (!i->root) {
@@ -174,6 +191,11 @@ static gboolean load_file(ObtXmlInst *i,
                 else {
                     i->path = g_strdup(path);
                     r = TRUE; /* ok! */
+
+                    /* documents with errors are parsed each time so that
+                       the errors are reported */
+                    if (!cached && !xmlGetLastError())
+                        obt_xml_cache_save(i->xdg_paths, path, i->doc);
                 }
             }
         }
@@ -304,6 +326,107 @@ gboolean obt_xml_load_mem(ObtXmlInst *i,
     return r;
 }
 
+static void stream_end_element(void *ctx, const xmlChar *localname,
+                               const xmlChar *prefix, const xmlChar *URI)
+{
+    xmlParserCtxtPtr ctxt = ctx;
+    ObtXmlInst *i = ctxt->_private;
+    xmlNodePtr node, n;
+
+    node = ctxt->node;
+    xmlSAX2EndElementNs(ctx, localname, prefix, URI);
+
+    /* only the children of the root element are handed out, each one once
+       it is complete */
+    if (i->stream_bad || ctxt->nodeNr != 1 || node->parent != ctxt->node)
+        return;
+
+    if (!i->doc) {
+        i->doc = ctxt->myDoc;
+        i->root = xmlDocGetRootElement(i->doc);
+        if (xmlStrcmp(i->root->name, (const xmlChar*)i->stream_root)) {
+            g_message("XML document is of wrong type. Root "
+                      "node is not '%s'", i->stream_root);
+            i->stream_bad = TRUE;
+            i->doc = NULL;
+            i->root = NULL;
+            return;
+        }
+    }
+
+    obt_xml_tree(i, node);
+
+    /* it has been handled, so it is not needed anymore, nor is anything
+       before it */
+    while ((n = i->root->children)) {
+        xmlUnlinkNode(n);
+        xmlFreeNode(n);
+    }
+}
+
+void obt_xml_stream_begin(ObtXmlInst *i, const gchar *root_node)
+{
+    g_assert(i->doc == NULL); /* another doc isn't open already? */
+    g_assert(i->stream == NULL);
+
+    xmlResetLastError();
+
+    i->stream = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
+    xmlCtxtUseOptions(i->stream, XML_PARSE_NOBLANKS);
+    i->stream->_private = i;
+    i->stream->sax->endElementNs = stream_end_element;
+    i->stream_root = g_strdup(root_node);
+    i->stream_bad = FALSE;
+}
+
+gboolean obt_xml_stream_feed(ObtXmlInst *i, const gchar *data, gsize len)
+{
+    g_assert(i->stream); /* a stream is open? */
+
+    if (!i->stream_bad && i->stream->wellFormed)
+        xmlParseChunk(i->stream, data, len, FALSE);
+    return !i->stream_bad && i->stream->wellFormed;
+}
+
+gboolean obt_xml_stream_end(ObtXmlInst *i)
+{
+    xmlParserCtxtPtr ctxt = i->stream;
+    gboolean r;
+
+    g_assert(ctxt); /* a stream is open? */
+
+    if (!i->stream_bad && ctxt->wellFormed)
+        xmlParseChunk(ctxt, NULL, 0, TRUE);
+
+    r = !i->stream_bad && ctxt->wellFormed;
+    if (r && !i->doc) {
+        /* the root had no children, so it was not checked yet */
+        xmlNodePtr root;
+
+        root = ctxt->myDoc ? xmlDocGetRootElement(ctxt->myDoc) : NULL;
+        if (!root) {
+            g_message("Given memory is an empty document");
+            r = FALSE;
+        }
+        else if (xmlStrcmp(root->name, (const xmlChar*)i->stream_root)) {
+            g_message("XML document is of wrong type. Root "
+                      "node is not '%s'", i->stream_root);
+            r = FALSE;
+        }
+    }
+
+    obt_xml_save_last_error(i);
+
+    if (ctxt->myDoc) xmlFreeDoc(ctxt->myDoc);
+    xmlFreeParserCtxt(ctxt);
+    g_free(i->stream_root);
+    i->stream = NULL;
+    i->stream_root = NULL;
+    i->doc = NULL;
+    i->root = NULL;
+    return r;
+}
+
 static void obt_xml_save_last_error(ObtXmlInst* inst)
 {
     xmlErrorPtr error = xmlGetLastError();
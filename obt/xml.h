@@ -51,6 +51,20 @@ gboolean obt_xml_load_theme_file(ObtXmlInst *inst,
 gboolean obt_xml_load_mem(ObtXmlInst *inst,
                           gpointer data, guint len, const gchar *root_node);
 
+/*! Parse a document as it arrives in pieces, instead of loading it all at
+  once.  The registered callbacks are called for each child of the root node
+  as soon as it is complete, and it is freed afterwards, so only one of them
+  is kept in memory at a time.  obt_xml_root() can not be used while
+  streaming.
+*/
+void obt_xml_stream_begin(ObtXmlInst *inst, const gchar *root_node);
+/*! Parse the next piece of the document.  Returns FALSE once the document is
+  found to be invalid, and the rest of it should not be given. */
+gboolean obt_xml_stream_feed(ObtXmlInst *inst, const gchar *data, gsize len);
+/*! Finish parsing the document.  Returns TRUE if it was a valid document with
+  the right root node. */
+gboolean obt_xml_stream_end(ObtXmlInst *inst);
+
 /* Returns true if an error is present. */
 gboolean obt_xml_last_error(ObtXmlInst *inst);
 gchar* obt_xml_last_error_file(ObtXmlInst *inst);
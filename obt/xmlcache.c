@@ -0,0 +1,448 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   obt/xmlcache.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+/* A parsed XML document, with its XIncludes already processed, is saved in
+   the cache directory as a flat list of node records.  When none of the files
+   which went into it have changed, the document is rebuilt from the mapped
+   cache file with the tree functions, without going through the parser.
+
+   The cache file is made of:
+     header: "OBXC", version, byte order mark
+     deps:   count, then (path, mtime, size) for each file read to make the
+             document.  mtime is only to the second, so no cache is saved
+             while one of them was changed in the current second, as it could
+             change again without its mtime moving.
+     nodes:  the document's children, depth first.  An element's children
+             follow it and are ended by an end record.
+
+   Numbers are stored in the machine's byte order, and strings as a length
+   followed by the bytes and a terminating NUL, so that they can be used
+   straight from the mapped file.
+*/
+
+#include "obt/internal.h"
+#include "obt/paths.h"
+
+#include <libxml/tree.h>
+#include <libxml/uri.h>
+#include <glib.h>
+
+#ifdef HAVE_STRING_H
+#  include <string.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#include <time.h>
+
+#define CACHE_MAGIC "OBXC"
+#define CACHE_VERSION 1
+#define CACHE_BOM 0x01020304
+
+typedef enum {
+    REC_END = 'e',
+    REC_ELEMENT = 'E',
+    REC_TEXT = 'T',
+    REC_CDATA = 'C',
+    REC_COMMENT = 'M',
+    REC_PI = 'P'
+} RecordType;
+
+typedef struct {
+    const gchar *p;
+    const gchar *end;
+    gboolean error;
+} Reader;
+
+static gchar* cache_path(ObtPaths *p, const gchar *path)
+{
+    gchar *name, *c, *r;
+
+    /* the file's full path is its name in the cache */
+    name = g_strdup(path);
+    for (c = name; *c; ++c)
+        if (*c == G_DIR_SEPARATOR) *c = '!';
+    r = g_build_filename(obt_paths_cache_home(p), "openbox", "xml", name,
+                         NULL);
+    g_free(name);
+    return r;
+}
+
+/* writing */
+
+static void put_u32(GString *b, guint32 v)
+{
+    g_string_append_len(b, (const gchar*)&v, sizeof(v));
+}
+
+static void put_i64(GString *b, gint64 v)
+{
+    g_string_append_len(b, (const gchar*)&v, sizeof(v));
+}
+
+static void put_str(GString *b, const xmlChar *s)
+{
+    guint32 len = s ? strlen((const gchar*)s) : 0;
+
+    put_u32(b, len);
+    g_string_append_len(b, s ? (const gchar*)s : "", len);
+    g_string_append_c(b, '\0');
+}
+
+static gboolean put_dep(GString *b, const gchar *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) < 0) return FALSE;
+    /* another change within this second would look the same */
+    if (st.st_mtime >= time(NULL)) return FALSE;
+    put_str(b, (const xmlChar*)path);
+    put_i64(b, st.st_mtime);
+    put_i64(b, st.st_size);
+    return TRUE;
+}
+
+/*! Find the files that were included into the document.  Returns FALSE if
+  one of them can not be found on disk. */
+static gboolean find_includes(xmlDocPtr doc, xmlNodePtr n, GSList **deps)
+{
+    gboolean ok = TRUE;
+
+    for (; n && ok; n = n->next) {
+        if (n->type == XML_XINCLUDE_START) {
+            xmlChar *href, *base, *uri;
+
+            href = xmlGetProp(n, (const xmlChar*)"href");
+            base = xmlNodeGetBase(doc, n);
+            uri = href ? xmlBuildURI(href, base) : NULL;
+            if (uri) {
+                gchar *path;
+
+                if (!strncmp((gchar*)uri, "file:", 5))
+                    path = g_filename_from_uri((gchar*)uri, NULL, NULL);
+                else
+                    path = g_strdup((gchar*)uri);
+                if (path && g_path_is_absolute(path))
+                    *deps = g_slist_prepend(*deps, path);
+                else {
+                    g_free(path);
+                    ok = FALSE;
+                }
+            }
+            else
+                ok = FALSE;
+            xmlFree(href);
+            xmlFree(base);
+            xmlFree(uri);
+        }
+        else if (n->type == XML_ELEMENT_NODE)
+            ok = find_includes(doc, n->children, deps);
+    }
+    return ok;
+}
+
+static gboolean put_nodes(GString *b, xmlNodePtr n)
+{
+    for (; n; n = n->next) {
+        switch (n->type) {
+        case XML_ELEMENT_NODE: {
+            xmlAttrPtr a;
+            guint32 count = 0;
+
+            g_string_append_c(b, REC_ELEMENT);
+            put_str(b, n->name);
+            put_str(b, n->ns ? n->ns->href : NULL);
+            put_str(b, n->ns ? n->ns->prefix : NULL);
+
+            for (a = n->properties; a; a = a->next) ++count;
+            put_u32(b, count);
+            for (a = n->properties; a; a = a->next) {
+                xmlChar *v = xmlNodeGetContent((xmlNodePtr)a);
+                put_str(b, a->name);
+                put_str(b, a->ns ? a->ns->href : NULL);
+                put_str(b, a->ns ? a->ns->prefix : NULL);
+                put_str(b, v);
+                xmlFree(v);
+            }
+
+            if (!put_nodes(b, n->children)) return FALSE;
+            break;
+        }
+        case XML_TEXT_NODE:
+            g_string_append_c(b, REC_TEXT);
+            put_str(b, n->content);
+            break;
+        case XML_CDATA_SECTION_NODE:
+            g_string_append_c(b, REC_CDATA);
+            put_str(b, n->content);
+            break;
+        case XML_COMMENT_NODE:
+            g_string_append_c(b, REC_COMMENT);
+            put_str(b, n->content);
+            break;
+        case XML_PI_NODE:
+            g_string_append_c(b, REC_PI);
+            put_str(b, n->name);
+            put_str(b, n->content);
+            break;
+        case XML_XINCLUDE_START:
+        case XML_XINCLUDE_END:
+        case XML_DTD_NODE:
+            break; /* markers that nothing looks at */
+        default:
+            return FALSE; /* entities and such are not cached */
+        }
+    }
+    g_string_append_c(b, REC_END);
+    return TRUE;
+}
+
+void obt_xml_cache_save(ObtPaths *p, const gchar *path, xmlDocPtr doc)
+{
+    GString *b;
+    GSList *deps = NULL, *it;
+    gboolean ok;
+    gchar *cpath, *dir;
+
+    cpath = cache_path(p, path);
+
+    b = g_string_new(CACHE_MAGIC);
+    put_u32(b, CACHE_VERSION);
+    put_u32(b, CACHE_BOM);
+
+    ok = find_includes(doc, doc->children, &deps);
+    deps = g_slist_prepend(deps, g_strdup(path));
+    put_u32(b, g_slist_length(deps));
+    for (it = deps; it; it = g_slist_next(it)) {
+        if (ok) ok = put_dep(b, it->data);
+        g_free(it->data);
+    }
+    g_slist_free(deps);
+
+    if (ok) ok = put_nodes(b, doc->children);
+
+    if (ok) {
+        dir = g_path_get_dirname(cpath);
+        obt_paths_mkdir_path(dir, 0700);
+        g_free(dir);
+        g_file_set_contents(cpath, b->str, b->len, NULL);
+    }
+    else
+        unlink(cpath); /* don't leave an old one around */
+
+    g_string_free(b, TRUE);
+    g_free(cpath);
+}
+
+/* reading */
+
+static guint32 get_u32(Reader *r)
+{
+    guint32 v = 0;
+
+    if (r->end - r->p < (gssize)sizeof(v))
+        r->error = TRUE;
+    else {
+        memcpy(&v, r->p, sizeof(v));
+        r->p += sizeof(v);
+    }
+    return v;
+}
+
+static gint64 get_i64(Reader *r)
+{
+    gint64 v = 0;
+
+    if (r->end - r->p < (gssize)sizeof(v))
+        r->error = TRUE;
+    else {
+        memcpy(&v, r->p, sizeof(v));
+        r->p += sizeof(v);
+    }
+    return v;
+}
+
+/*! Returns a pointer to the string in the mapped file */
+static const xmlChar* get_str(Reader *r)
+{
+    guint32 len;
+    const gchar *s;
+
+    len = get_u32(r);
+    if (r->error || r->end - r->p < (gssize)len + 1 || r->p[len] != '\0') {
+        r->error = TRUE;
+        return (const xmlChar*)"";
+    }
+    s = r->p;
+    r->p += len + 1;
+    return (const xmlChar*)s;
+}
+
+static guchar get_type(Reader *r)
+{
+    if (r->p >= r->end) {
+        r->error = TRUE;
+        return REC_END;
+    }
+    return *(r->p++);
+}
+
+static xmlNsPtr find_ns(xmlDocPtr doc, xmlNodePtr node,
+                        const xmlChar *href, const xmlChar *prefix)
+{
+    xmlNsPtr ns;
+
+    if (!*href) return NULL;
+    if (!(ns = xmlSearchNsByHref(doc, node, href)))
+        ns = xmlNewNs(node, href, *prefix ? prefix : NULL);
+    return ns;
+}
+
+static void get_nodes(Reader *r, xmlDocPtr doc, xmlNodePtr parent)
+{
+    while (!r->error) {
+        guchar type;
+        xmlNodePtr n = NULL;
+
+        switch ((type = get_type(r))) {
+        case REC_END:
+            return;
+        case REC_ELEMENT: {
+            const xmlChar *name, *href, *prefix;
+            guint32 i, count;
+
+            name = get_str(r);
+            href = get_str(r);
+            prefix = get_str(r);
+            if (r->error) return;
+
+            n = xmlNewDocNode(doc, NULL, name, NULL);
+            /* it needs to be in the tree for its namespace to be found */
+            if (parent) xmlAddChild(parent, n);
+            else xmlAddChild((xmlNodePtr)doc, n);
+            xmlSetNs(n, find_ns(doc, n, href, prefix));
+
+            count = get_u32(r);
+            for (i = 0; i < count && !r->error; ++i) {
+                const xmlChar *value;
+
+                name = get_str(r);
+                href = get_str(r);
+                prefix = get_str(r);
+                value = get_str(r);
+                if (!r->error)
+                    xmlNewNsProp(n, find_ns(doc, n, href, prefix),
+                                 name, value);
+            }
+            get_nodes(r, doc, n);
+            continue; /* it was added already */
+        }
+        case REC_TEXT:
+            n = xmlNewDocText(doc, get_str(r));
+            break;
+        case REC_CDATA: {
+            const xmlChar *s = get_str(r);
+            n = xmlNewCDataBlock(doc, s, xmlStrlen(s));
+            break;
+        }
+        case REC_COMMENT:
+            n = xmlNewDocComment(doc, get_str(r));
+            break;
+        case REC_PI: {
+            const xmlChar *name = get_str(r);
+            n = xmlNewDocPI(doc, name, get_str(r));
+            break;
+        }
+        default:
+            r->error = TRUE;
+            return;
+        }
+
+        if (r->error) {
+            xmlFreeNode(n);
+            return;
+        }
+        if (parent) xmlAddChild(parent, n);
+        else xmlAddChild((xmlNodePtr)doc, n);
+    }
+}
+
+/*! Returns TRUE if none of the files the document was made from changed */
+static gboolean deps_valid(Reader *r, const gchar *path)
+{
+    guint32 i, count;
+
+    count = get_u32(r);
+    for (i = 0; i < count && !r->error; ++i) {
+        const gchar *dep;
+        gint64 mtime, size;
+        struct stat st;
+
+        dep = (const gchar*)get_str(r);
+        mtime = get_i64(r);
+        size = get_i64(r);
+        if (r->error) return FALSE;
+
+        /* the first one is the document itself */
+        if (i == 0 && strcmp(dep, path)) return FALSE;
+        if (stat(dep, &st) < 0) return FALSE;
+        if (st.st_mtime != mtime || st.st_size != size) return FALSE;
+    }
+    return count > 0 && !r->error;
+}
+
+xmlDocPtr obt_xml_cache_load(ObtPaths *p, const gchar *path)
+{
+    GMappedFile *f;
+    gchar *cpath;
+    Reader r;
+    xmlDocPtr doc = NULL;
+
+    cpath = cache_path(p, path);
+    f = g_mapped_file_new(cpath, FALSE, NULL);
+    g_free(cpath);
+    if (!f) return NULL;
+
+    r.p = g_mapped_file_get_contents(f);
+    r.end = r.p + g_mapped_file_get_length(f);
+    r.error = FALSE;
+
+    if (r.end - r.p >= 4 && !strncmp(r.p, CACHE_MAGIC, 4)) {
+        r.p += 4;
+        if (get_u32(&r) == CACHE_VERSION && get_u32(&r) == CACHE_BOM &&
+            deps_valid(&r, path))
+        {
+            doc = xmlNewDoc((const xmlChar*)"1.0");
+            doc->URL = xmlStrdup((const xmlChar*)path);
+            get_nodes(&r, doc, NULL);
+            if (r.error) {
+                xmlFreeDoc(doc);
+                doc = NULL;
+            }
+        }
+    }
+
+    g_mapped_file_free(f);
+    return doc;
+}
@@ -18,6 +18,7 @@
 
 #include "obt/xqueue.h"
 #include "obt/display.h"
+#include "obt/internal.h"
 
 #define MINSZ 16
 
@@ -100,6 +101,10 @@ static gboolean read_events(gboolean block)
         if (XNextEvent(obt_display, &e) != Success)
             return FALSE;
 
+        /* drop cached properties as soon as we know they changed, even if
+           the event is not processed yet */
+        obt_prop_cache_event(&e);
+
         grow(); /* make sure there is room */
 
         ++qnum;
@@ -165,6 +170,11 @@ void xqueue_init(void)
     qend = -1;
 }
 
+void xqueue_read_pending(void)
+{
+    if (q != NULL) read_events(FALSE);
+}
+
 void xqueue_destroy(void)
 {
     if (q == NULL) return;
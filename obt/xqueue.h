@@ -62,6 +62,10 @@ gboolean xqueue_next_local(XEvent *event_return);
   otherwise. */
 gboolean xqueue_pending_local(void);
 
+/*! Moves the events which have already arrived from the server into the
+  local event queue, without waiting for any more. */
+void xqueue_read_pending(void);
+
 /*! Returns TRUE and passes the next event in the queue, or FALSE if there
   is an error */
 gboolean xqueue_peek(XEvent *event_return);
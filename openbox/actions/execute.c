@@ -5,6 +5,7 @@
 #include "openbox/prompt.h"
 #include "openbox/screen.h"
 #include "obt/paths.h"
+#include "obt/signal.h"
 #include "gettext.h"
 
 #ifdef HAVE_STDLIB_H
@@ -289,7 +290,7 @@ static gboolean run_func(ObActionsData *data, gpointer options)
         ok = g_spawn_async(NULL, argv, NULL,
                            G_SPAWN_SEARCH_PATH |
                            G_SPAWN_DO_NOT_REAP_CHILD,
-                           NULL, NULL, NULL, &e);
+                           obt_signal_child_setup, NULL, NULL, &e);
         if (!ok) {
             g_message("%s", e->message);
             g_error_free(e);
@@ -62,7 +62,7 @@ static gboolean run_func(ObActionsData *data, gpointer options)
         if (o->x_denom || o->y_denom) {
             const Rect *carea;
 
-            carea = screen_area(c->desktop, client_monitor(c), NULL);
+            carea = screen_work_area(c->desktop, client_monitor(c));
             if (o->x_denom)
                 x = (x * carea->width) / o->x_denom;
             if (o->y_denom)
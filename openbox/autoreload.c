@@ -0,0 +1,136 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   autoreload.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "autoreload.h"
+#include "openbox.h"
+#include "config.h"
+#include "menu.h"
+#include "debug.h"
+#include "obt/paths.h"
+#include "obt/watch.h"
+
+#include <string.h>
+
+/*! Editors often write a file in a few steps, so wait for them to finish */
+#define AUTORELOAD_DELAY 500 /* milliseconds */
+
+static ObtWatch *watch = NULL;
+
+static gboolean is_menu_file(const gchar *name)
+{
+    GSList *it;
+
+    if (config_menu_files == NULL)
+        return !strcmp(name, "menu.xml");
+    for (it = config_menu_files; it; it = g_slist_next(it))
+        if (!strcmp(name, it->data))
+            return TRUE;
+    return FALSE;
+}
+
+static void reconfigure_changed(ObtWatch *w, const gchar *base_path,
+                                const gchar *subpath, ObtWatchNotifyType type,
+                                gpointer data)
+{
+    ob_debug("%s%s%s changed, reconfiguring", base_path,
+             subpath[0] ? "/" : "", subpath);
+    ob_reconfigure();
+}
+
+static void menu_changed(ObtWatch *w, const gchar *base_path,
+                         const gchar *subpath, ObtWatchNotifyType type,
+                         gpointer data)
+{
+    menu_reload();
+}
+
+static void config_dir_changed(ObtWatch *w, const gchar *base_path,
+                               const gchar *subpath, ObtWatchNotifyType type,
+                               gpointer data)
+{
+    if (!ob_config_file() && !strcmp(subpath, "rc.xml"))
+        reconfigure_changed(w, base_path, subpath, type, data);
+    else if (is_menu_file(subpath))
+        menu_changed(w, base_path, subpath, type, data);
+}
+
+static void applications_changed(ObtWatch *w, const gchar *base_path,
+                                 const gchar *subpath,
+                                 ObtWatchNotifyType type, gpointer data)
+{
+    /* pipe menus often list the installed applications, so run them again
+       the next time they are shown */
+    menu_expire_pipe_caches();
+}
+
+void autoreload_startup(gboolean reconfig)
+{
+    ObtPaths *p;
+    GSList *it;
+
+    watch = obt_watch_new();
+    obt_watch_set_delay(watch, AUTORELOAD_DELAY);
+
+    p = obt_paths_new();
+
+    /* rc.xml and menu files found in the config directories */
+    for (it = obt_paths_config_dirs(p); it; it = g_slist_next(it)) {
+        gchar *d = g_build_filename(it->data, "openbox", NULL);
+        obt_watch_add(watch, d, FALSE, config_dir_changed, NULL);
+        g_free(d);
+    }
+
+    /* files given with their full path */
+    if (ob_config_file())
+        obt_watch_add(watch, ob_config_file(), FALSE,
+                      reconfigure_changed, NULL);
+    for (it = config_menu_files; it; it = g_slist_next(it))
+        if (g_path_is_absolute(it->data))
+            obt_watch_add(watch, it->data, FALSE, menu_changed, NULL);
+
+    /* the theme is used all over, so changing it needs a reconfigure */
+    if (config_theme) {
+        gchar *d;
+
+        d = g_build_filename(g_get_home_dir(), ".themes", config_theme,
+                             "openbox-3", NULL);
+        obt_watch_add(watch, d, FALSE, reconfigure_changed, NULL);
+        g_free(d);
+        for (it = obt_paths_data_dirs(p); it; it = g_slist_next(it)) {
+            d = g_build_filename(it->data, "themes", config_theme,
+                                 "openbox-3", NULL);
+            obt_watch_add(watch, d, FALSE, reconfigure_changed, NULL);
+            g_free(d);
+        }
+    }
+
+    /* installed applications */
+    for (it = obt_paths_data_dirs(p); it; it = g_slist_next(it)) {
+        gchar *d = g_build_filename(it->data, "applications", NULL);
+        obt_watch_add(watch, d, TRUE, applications_changed, NULL);
+        g_free(d);
+    }
+
+    obt_paths_unref(p);
+}
+
+void autoreload_shutdown(gboolean reconfig)
+{
+    obt_watch_unref(watch);
+    watch = NULL;
+}
@@ -0,0 +1,29 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   autoreload.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __autoreload_h
+#define __autoreload_h
+
+#include <glib.h>
+
+/*! Watches the config files, menu files, theme and application directories,
+  and reloads whatever depends on them when they change. */
+void autoreload_startup(gboolean reconfig);
+void autoreload_shutdown(gboolean reconfig);
+
+#endif
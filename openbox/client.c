@@ -39,6 +39,9 @@
 #include "menuframe.h"
 #include "keyboard.h"
 #include "mouse.h"
+#include "ipc.h"
+#include "publish.h"
+#include "spatial.h"
 #include "obrender/render.h"
 #include "gettext.h"
 #include "obt/display.h"
@@ -74,6 +77,15 @@ GList          *client_list             = NULL;
 static GSList  *client_destroy_notifies = NULL;
 static RrImage *client_default_icon     = NULL;
 
+/*! The state hints waiting to be written until client_showhide_end() */
+#define PENDING_STATE    (1 << 0)
+#define PENDING_WM_STATE (1 << 1)
+
+/*! How many times client_showhide_begin() has been called without an end */
+static guint       showhide_batch   = 0;
+/*! Maps an ObClient* to the PENDING_ flags for its state hints */
+static GHashTable *showhide_pending = NULL;
+
 static void client_get_all(ObClient *self, gboolean real);
 static void client_get_startup_id(ObClient *self);
 static void client_get_session_ids(ObClient *self);
@@ -123,6 +135,8 @@ void client_startup(gboolean reconfig)
 
     if (reconfig) return;
 
+    showhide_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+
     client_set_list();
 }
 
@@ -132,6 +146,9 @@ void client_shutdown(gboolean reconfig)
     client_default_icon = NULL;
 
     if (reconfig) return;
+
+    g_hash_table_destroy(showhide_pending);
+    showhide_pending = NULL;
 }
 
 static void client_call_notifies(ObClient *self, GSList *list)
@@ -182,7 +199,7 @@ void client_remove_destroy_notify_data(ObClientCallback func, gpointer data)
     }
 }
 
-void client_set_list(void)
+static void client_write_list(void)
 {
     Window *windows, *win_it;
     GList *it;
@@ -202,7 +219,12 @@ void client_set_list(void)
 
     if (windows)
         g_free(windows);
+}
 
+void client_set_list(void)
+{
+    publish_later(client_write_list);
+    ipc_client_list_changed();
     stacking_set_list();
 }
 
@@ -229,6 +251,9 @@ void client_manage(Window window, ObPrompt *prompt)
     attrib_set.do_not_propagate_mask = CLIENT_NOPROPAGATEMASK;
     XChangeWindowAttributes(obt_display, window,
                             CWEventMask|CWDontPropagate, &attrib_set);
+    /* we get PropertyNotify events for the window from here on, so its
+       properties can be cached */
+    obt_prop_cache_watch(window);
 
     /* create the ObClient struct, and populate it from the hints on the
        window */
@@ -302,7 +327,7 @@ void client_manage(Window window, ObPrompt *prompt)
     launch_time = sn_app_started(self->startup_id, self->class, self->name);
 
     if (!OBT_PROP_GET32(self->window, NET_WM_USER_TIME, CARDINAL, &user_time))
-        user_time = event_time();
+        user_time = event_time_estimate();
 
     /* do this after we have a frame.. it uses the frame to help determine the
        WM_STATE to apply. */
@@ -380,15 +405,14 @@ void client_manage(Window window, ObPrompt *prompt)
             /* oldschool fullscreen windows are allowed */
             !client_is_oldfullscreen(self, &place))
         {
-            Rect *r;
+            const Rect *r;
 
-            r = screen_area(self->desktop, SCREEN_AREA_ALL_MONITORS, NULL);
+            r = screen_work_area(self->desktop, SCREEN_AREA_ALL_MONITORS);
             if (r->x || r->y) {
                 place.x = r->x;
                 place.y = r->y;
                 ob_debug("Moving buggy app from (0,0) to (%d,%d)", r->x, r->y);
             }
-            g_slice_free(Rect, r);
         }
 
         /* make sure the window is visible. */
@@ -482,6 +506,11 @@ void client_manage(Window window, ObPrompt *prompt)
        on map. */
     OBT_PROP_SET32(self->window, NET_WM_DESKTOP, CARDINAL, self->desktop);
 
+    /* the desktop is settled now.  be on its list before showing the window,
+       as focusing it may switch to its desktop, which shows the windows on
+       the list */
+    screen_add_desktop_client(self);
+
     /* grab mouse bindings before showing the window */
     mouse_grab_for_client(self, TRUE);
 
@@ -525,10 +554,11 @@ void client_manage(Window window, ObPrompt *prompt)
     /* add to client list/map */
     client_list = g_list_append(client_list, self);
     window_add(&self->window, CLIENT_AS_WINDOW(self));
+    spatial_update(self);
 
     /* this has to happen after we're in the client_list */
     if (STRUT_EXISTS(self->strut))
-        screen_update_areas();
+        screen_update_client_strut(self);
 
     /* update the list hints */
     client_set_list();
@@ -593,6 +623,7 @@ void client_unmanage(ObClient *self)
     /* we dont want events no more. do this before hiding the frame so we
        don't generate more events */
     XSelectInput(obt_display, self->window, NoEventMask);
+    obt_prop_cache_unwatch(self->window);
 
     /* ignore enter events from the unmap so it doesnt mess with the focus */
     if (!config_focus_under_mouse)
@@ -626,13 +657,15 @@ void client_unmanage(ObClient *self)
     self->kill_prompt = NULL;
 
     client_list = g_list_remove(client_list, self);
-    stacking_remove(self);
+    screen_remove_desktop_client(self);
+    g_hash_table_remove(showhide_pending, self);
+    stacking_remove(CLIENT_AS_WINDOW(self));
     window_remove(self->window);
 
     /* once the client is out of the list, update the struts to remove its
        influence */
     if (STRUT_EXISTS(self->strut))
-        screen_update_areas();
+        screen_update_client_strut(self);
 
     client_call_notifies(self, client_destroy_notifies);
 
@@ -2011,7 +2044,7 @@ void client_update_wmhints(ObClient *self)
     /* assume a window takes input if it doesn't specify */
     self->can_focus = TRUE;
 
-    if ((hints = XGetWMHints(obt_display, self->window)) != NULL) {
+    if ((hints = obt_prop_get_wmhints(self->window)) != NULL) {
         gboolean ur;
 
         if (hints->flags & InputHint)
@@ -2137,6 +2170,7 @@ void client_update_title(ObClient *self)
 
     if (self->frame)
         frame_adjust_title(self->frame);
+    ipc_client_changed(self, OB_IPC_EVENT_TITLE);
 
     /* update the icon title */
     data = NULL;
@@ -2217,7 +2251,7 @@ void client_update_strut(ObClient *self)
         /* updating here is pointless while we're being mapped cuz we're not in
            the client list yet */
         if (self->frame)
-            screen_update_areas();
+            screen_update_client_strut(self);
     }
 }
 
@@ -2273,7 +2307,7 @@ void client_update_icons(ObClient *self)
     if (!img) {
         XWMHints *hints;
 
-        if ((hints = XGetWMHints(obt_display, self->window))) {
+        if ((hints = obt_prop_get_wmhints(self->window))) {
             if (hints->flags & IconPixmapHint) {
                 gboolean xicon;
                 obt_display_ignore_errors(TRUE);
@@ -2499,11 +2533,27 @@ static void client_save_app_rule_values(ObClient *self)
     OBT_PROP_SETS(self->window, OB_APP_TYPE, client_type_to_string(self));
 }
 
+/*! Returns TRUE if the state hints are being batched up, and marks them to
+  be written at the end of it */
+static gboolean client_change_later(ObClient *self, guint what)
+{
+    guint pending;
+
+    if (!showhide_batch) return FALSE;
+
+    pending = GPOINTER_TO_UINT(g_hash_table_lookup(showhide_pending, self));
+    g_hash_table_insert(showhide_pending, self,
+                        GUINT_TO_POINTER(pending | what));
+    return TRUE;
+}
+
 static void client_change_wm_state(ObClient *self)
 {
     gulong state[2];
     glong old;
 
+    if (client_change_later(self, PENDING_WM_STATE)) return;
+
     old = self->wmstate;
 
     if (self->shaded || self->iconic ||
@@ -2528,6 +2578,8 @@ static void client_change_state(ObClient *self)
     gulong netstate[12];
     guint num;
 
+    if (client_change_later(self, PENDING_STATE)) return;
+
     num = 0;
     if (self->modal)
         netstate[num++] = OBT_PROP_ATOM(NET_WM_STATE_MODAL);
@@ -2803,6 +2855,38 @@ void client_showhide(ObClient *self)
         client_hide(self);
 }
 
+void client_showhide_begin(void)
+{
+    /* hold the server so that every window changes at once, and so showing
+       each frame doesn't have to wait on its own grab */
+    if (showhide_batch++ == 0)
+        grab_server(TRUE);
+}
+
+static void change_pending_func(gpointer key, gpointer val, gpointer data)
+{
+    ObClient *c = key;
+    guint pending = GPOINTER_TO_UINT(val);
+
+    if (pending & PENDING_STATE)
+        client_change_state(c);
+    if (pending & PENDING_WM_STATE)
+        client_change_wm_state(c);
+}
+
+void client_showhide_end(void)
+{
+    g_assert(showhide_batch > 0);
+
+    if (--showhide_batch > 0) return;
+
+    g_hash_table_foreach(showhide_pending, change_pending_func, NULL);
+    g_hash_table_remove_all(showhide_pending);
+
+    /* this flushes everything to the server */
+    grab_server(FALSE);
+}
+
 gboolean client_normal(ObClient *self) {
     return ! (self->type == OB_CLIENT_TYPE_DESKTOP ||
               self->type == OB_CLIENT_TYPE_DOCK ||
@@ -3229,6 +3313,8 @@ void client_configure(ObClient *self, gint x, gint y, gint w, gint h,
 
         if (!user)
             event_end_ignore_all_enters(ignore_start);
+
+        ipc_client_changed(self, OB_IPC_EVENT_GEOMETRY);
     }
 
     if (!user || final) {
@@ -3747,10 +3833,14 @@ static void client_set_desktop_recursive(ObClient *self,
         g_assert(target < screen_num_desktops || target == DESKTOP_ALL);
 
         old = self->desktop;
+        screen_remove_desktop_client(self);
         self->desktop = target;
+        screen_add_desktop_client(self);
         OBT_PROP_SET32(self->window, NET_WM_DESKTOP, CARDINAL, target);
         /* the frame can display the current desktop state */
         frame_adjust_state(self->frame);
+        spatial_update(self);
+        ipc_client_changed(self, OB_IPC_EVENT_DESKTOP);
         /* 'move' the window to the new desktop */
         if (!donthide)
             client_hide(self);
@@ -3759,11 +3849,10 @@ static void client_set_desktop_recursive(ObClient *self,
         if (old != DESKTOP_ALL && !dontraise)
             stacking_raise(CLIENT_AS_WINDOW(self));
         if (STRUT_EXISTS(self->strut))
-            screen_update_areas();
-        else
-            /* the new desktop's geometry may be different, so we may need to
-               resize, for example if we are maximized */
-            client_reconfigure(self, FALSE);
+            screen_update_client_strut(self);
+        /* the new desktop's geometry may be different, so we may need to
+           resize, for example if we are maximized */
+        client_reconfigure(self, FALSE);
 
         focus_cycle_addremove(self, FALSE);
     }
@@ -3824,8 +3913,9 @@ gboolean client_validate(ObClient *self)
 {
     struct ObClientFindDestroyUnmap find;
 
-    XSync(obt_display, FALSE); /* get all events on the server */
-
+    /* look at the events which have arrived so far, without waiting for the
+       server.  if the window is destroyed after this, the requests we make
+       for it only cause BadWindow errors, which are harmless */
     find.window = self->window;
     find.ignore_unmaps = self->ignore_unmaps;
     if (xqueue_exists_local(find_destroy_unmap, &find))
@@ -4020,6 +4110,8 @@ gboolean client_can_focus(ObClient *self)
 
 gboolean client_focus(ObClient *self)
 {
+    gboolean error;
+
     if (!client_validate(self)) return FALSE;
 
     /* we might not focus this window, so if we have modal children which would
@@ -4040,7 +4132,7 @@ gboolean client_focus(ObClient *self)
 
     ob_debug_type(OB_DEBUG_FOCUS,
                   "Focusing client \"%s\" (0x%x) at time %u",
-                  self->title, self->window, event_time());
+                  self->title, self->window, event_time_estimate());
 
     /* if using focus_delay, stop the timer now so that focus doesn't
        go moving on us */
@@ -4072,9 +4164,9 @@ gboolean client_focus(ObClient *self)
 
     obt_display_ignore_errors(FALSE);
 
-    ob_debug_type(OB_DEBUG_FOCUS, "Error focusing? %d",
-                  obt_display_error_occured);
-    return !obt_display_error_occured;
+    error = obt_display_error_occured();
+    ob_debug_type(OB_DEBUG_FOCUS, "Error focusing? %d", error);
+    return !error;
 }
 
 static void client_present(ObClient *self, gboolean here, gboolean raise,
@@ -4110,7 +4202,8 @@ void client_activate(ObClient *self, gboolean desktop,
 {
     self = client_focus_target(self);
 
-    if (client_can_steal_focus(self, desktop, user, event_time(), CurrentTime))
+    if (client_can_steal_focus(self, desktop, user, event_time(),
+                               CurrentTime))
         client_present(self, here, raise, unshade);
     else
         client_hilite(self, TRUE);
@@ -4201,7 +4294,17 @@ void client_set_undecorated(ObClient *self, gboolean undecorated)
 
 guint client_monitor(ObClient *self)
 {
-    return screen_find_monitor(&self->frame->area);
+    ObFrame *f = self->frame;
+
+    /* only look again when the frame moved or the monitors changed */
+    if (f->monitor_serial != screen_monitors_serial ||
+        !RECT_EQUAL(f->monitor_area, f->area))
+    {
+        f->monitor = screen_find_monitor(&f->area);
+        f->monitor_area = f->area;
+        f->monitor_serial = screen_monitors_serial;
+    }
+    return f->monitor;
 }
 
 ObClient *client_direct_parent(ObClient *self)
@@ -4406,9 +4509,9 @@ void client_find_edge_directional(ObClient *self, ObDirection dir,
                                   gint my_edge_start, gint my_edge_size,
                                   gint *dest, gboolean *near_edge)
 {
-    GList *it;
+    GSList *it, *found;
     Rect *a;
-    Rect dock_area;
+    Rect dock_area, strip;
     gint edge;
     guint i;
 
@@ -4437,14 +4540,37 @@ void client_find_edge_directional(ObClient *self, ObDirection dir,
 
     /* search for edges of monitors */
     for (i = 0; i < screen_num_monitors; ++i) {
-        Rect *area = screen_area(self->desktop, i, NULL);
-        detect_edge(*area, dir, my_head, my_size, my_edge_start,
-                    my_edge_size, dest, near_edge);
-        g_slice_free(Rect, area);
+        detect_edge(*screen_work_area(self->desktop, i), dir, my_head, my_size,
+                    my_edge_start, my_edge_size, dest, near_edge);
     }
 
-    /* search for edges of clients */
-    for (it = client_list; it; it = g_list_next(it)) {
+    /* search for edges of clients.  only the ones which are beside us and
+       not past our tail can be chosen, so look in that part of the screen */
+    switch (dir) {
+    case OB_DIRECTION_NORTH:
+        RECT_SET(strip, my_edge_start, G_MINSHORT,
+                 my_edge_size, my_head + my_size + 1 - G_MINSHORT);
+        break;
+    case OB_DIRECTION_SOUTH:
+        RECT_SET(strip, my_edge_start, my_head - my_size - 1,
+                 my_edge_size, G_MAXSHORT - (my_head - my_size - 1));
+        break;
+    case OB_DIRECTION_WEST:
+        RECT_SET(strip, G_MINSHORT, my_edge_start,
+                 my_head + my_size + 1 - G_MINSHORT, my_edge_size);
+        break;
+    case OB_DIRECTION_EAST:
+        RECT_SET(strip, my_head - my_size - 1, my_edge_start,
+                 G_MAXSHORT - (my_head - my_size - 1), my_edge_size);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+    found = spatial_find_rect(&strip, screen_desktop, TRUE);
+    if (self->desktop != screen_desktop && self->desktop != DESKTOP_ALL)
+        found = g_slist_concat(found, spatial_find_rect(&strip, self->desktop,
+                                                        FALSE));
+    for (it = found; it; it = g_slist_next(it)) {
         ObClient *cur = it->data;
 
         /* skip windows to not bump into */
@@ -4452,15 +4578,14 @@ void client_find_edge_directional(ObClient *self, ObDirection dir,
             continue;
         if (cur->iconic)
             continue;
-        if (self->desktop != cur->desktop && cur->desktop != DESKTOP_ALL &&
-            cur->desktop != screen_desktop)
-            continue;
 
         ob_debug("trying window %s", cur->title);
 
         detect_edge(cur->frame->area, dir, my_head, my_size, my_edge_start,
                     my_edge_size, dest, near_edge);
     }
+    g_slist_free(found);
+
     dock_get_area(&dock_area);
     detect_edge(dock_area, dir, my_head, my_size, my_edge_start,
                 my_edge_size, dest, near_edge);
@@ -4673,28 +4798,24 @@ void client_find_resize_directional(ObClient *self,
 ObClient* client_under_pointer(void)
 {
     gint x, y;
-    GList *it;
+    GSList *it, *found;
     ObClient *ret = NULL;
 
     if (screen_pointer_pos(&x, &y)) {
-        for (it = stacking_list; it; it = g_list_next(it)) {
-            if (WINDOW_IS_CLIENT(it->data)) {
-                ObClient *c = WINDOW_AS_CLIENT(it->data);
-                if (c->frame->visible &&
-                    /* check the desktop, this is done during desktop
-                       switching and windows are shown/hidden status is not
-                       reliable */
-                    (c->desktop == screen_desktop ||
-                     c->desktop == DESKTOP_ALL) &&
-                    /* ignore all animating windows */
-                    !frame_iconify_animating(c->frame) &&
-                    RECT_CONTAINS(c->frame->area, x, y))
-                {
-                    ret = c;
-                    break;
-                }
+        /* check the desktop, this is done during desktop switching and
+           windows are shown/hidden status is not reliable */
+        found = spatial_find_point(x, y, screen_desktop, TRUE);
+        for (it = found; it; it = g_slist_next(it)) {
+            ObClient *c = it->data;
+            if (c->frame->visible &&
+                /* ignore all animating windows */
+                !frame_iconify_animating(c->frame) &&
+                (!ret || stacking_compare(c, ret) < 0))
+            {
+                ret = c;
             }
         }
+        g_slist_free(found);
     }
     return ret;
 }
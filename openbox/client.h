@@ -568,6 +568,13 @@ gboolean client_hide(ObClient *self);
 */
 void client_showhide(ObClient *self);
 
+/*! Begins showing and hiding a bunch of windows together.  The windows are
+  mapped and unmapped with the server grabbed, and their state hints are only
+  written once each, when client_showhide_end() is called to release the
+  server and flush it all out.  These can be nested. */
+void client_showhide_begin(void);
+void client_showhide_end(void);
+
 /*! Validate client, by making sure no Destroy or Unmap events exist in
   the event queue for the window.
   @return true if the client is valid; false if the client has already
@@ -98,6 +98,8 @@ guint    config_submenu_show_delay;
 guint    config_submenu_hide_delay;
 gboolean config_menu_manage_desktops;
 gboolean config_menu_show_icons;
+guint    config_menu_pipe_timeout;
+guint    config_menu_pipe_cache_time;
 
 GSList *config_menu_files;
 
@@ -949,6 +951,10 @@ static void parse_menu(xmlNodePtr node, gpointer d)
         config_submenu_hide_delay = obt_xml_node_int(n);
     if ((n = obt_xml_find_node(node, "manageDesktops")))
         config_menu_manage_desktops = obt_xml_node_bool(n);
+    if ((n = obt_xml_find_node(node, "pipeTimeout")))
+        config_menu_pipe_timeout = MAX(0, obt_xml_node_int(n));
+    if ((n = obt_xml_find_node(node, "pipeCacheTime")))
+        config_menu_pipe_cache_time = MAX(0, obt_xml_node_int(n));
     if ((n = obt_xml_find_node(node, "showIcons"))) {
         config_menu_show_icons = obt_xml_node_bool(n);
 #if !defined(USE_IMLIB2) && !defined(USE_LIBRSVG)
@@ -1167,6 +1173,8 @@ void config_startup(ObtXmlInst *i)
     config_menu_manage_desktops = TRUE;
     config_menu_files = NULL;
     config_menu_show_icons = TRUE;
+    config_menu_pipe_timeout = 10000;
+    config_menu_pipe_cache_time = 0;
 
     obt_xml_register(i, "menu", parse_menu, NULL);
 
@@ -211,6 +211,11 @@ extern guint    config_submenu_hide_delay;
 extern gboolean config_menu_manage_desktops;
 /*! Load & show icons in user-defined menus */
 extern gboolean config_menu_show_icons;
+/*! How long a pipe-menu's command may run, in milliseconds, 0 for no limit */
+extern guint    config_menu_pipe_timeout;
+/*! How long a pipe-menu's entries are kept, in seconds.  When 0 they are
+  made again each time a menu is opened */
+extern guint    config_menu_pipe_cache_time;
 /*! User-specified menu files */
 extern GSList *config_menu_files;
 /*! Per app settings */
@@ -155,6 +155,7 @@ static inline void log_argv(ObDebugType type,
     case OB_DEBUG_FOCUS:    prefix = "(FOCUS) ";           break;
     case OB_DEBUG_APP_BUGS: prefix = "(APPLICATION BUG) "; break;
     case OB_DEBUG_SM:       prefix = "(SESSION) ";         break;
+    case OB_DEBUG_LATENCY:  prefix = "(LATENCY) ";         break;
     default:                prefix = NULL;                 break;
     }
 
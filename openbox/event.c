@@ -82,6 +82,9 @@ typedef struct
 
 static void event_process(const XEvent *e, gpointer data);
 static void event_handle_root(XEvent *e);
+#ifdef XKB
+static void event_handle_xkb(XEvent *e);
+#endif
 static gboolean event_handle_menu_input(XEvent *e);
 static void event_handle_menu(ObMenuFrame *frame, XEvent *e);
 static gboolean event_handle_prompt(ObPrompt *p, XEvent *e);
@@ -106,8 +109,19 @@ static Time event_curtime = CurrentTime;
   to be trusted) */
 static Time event_sourcetime = CurrentTime;
 
+/*! The latest timestamp the server has given us on any event, or
+  CurrentTime if we have not seen one yet */
+static Time event_servertime = CurrentTime;
+/*! The local clock, in milliseconds, when event_servertime was seen */
+static gint64 event_servertime_local = 0;
+/*! Set while a request for a new timestamp is on its way to the server */
+static gboolean event_servertime_probing = FALSE;
+
 /*! The serial of the current X event */
 static gulong event_curserial;
+/*! The local clock, in milliseconds, when we began handling the current X
+  event, or 0 while no event is being handled */
+static gint64 event_curtime_local = 0;
 static gboolean focus_left_screen = FALSE;
 static gboolean waiting_for_focusin = FALSE;
 /*! A list of ObSerialRanges which are to be ignored for mouse enter events */
@@ -150,6 +164,15 @@ void event_startup(gboolean reconfig)
 
     xqueue_add_callback(event_process, NULL);
 
+#ifdef XKB
+    /* follow keyboard map changes through XKB, which says which keys
+       changed, instead of through MappingNotify, which doesn't */
+    if (obt_display_extension_xkb)
+        XkbSelectEvents(obt_display, XkbUseCoreKbd,
+                        XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+                        XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+#endif
+
 #ifdef USE_SM
     IceAddConnectionWatch(ice_watch, NULL);
 #endif
@@ -266,10 +289,32 @@ static inline Time event_get_timestamp(const XEvent *e)
     return t;
 }
 
+static gint64 local_time_ms(void)
+{
+    GTimeVal now;
+
+    g_get_current_time(&now);
+    return (gint64)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+static void update_server_time(XEvent *e, Time t)
+{
+    /* timestamps on events from other clients can't be trusted */
+    if (t == CurrentTime || e->xany.send_event) return;
+
+    if (!event_servertime || event_time_after(t, event_servertime)) {
+        event_servertime = t;
+        event_servertime_local = local_time_ms();
+        event_servertime_probing = FALSE;
+    }
+}
+
 static void event_set_curtime(XEvent *e)
 {
     Time t = event_get_timestamp(e);
 
+    update_server_time(e, t);
+
     /* watch that if we get an event earlier than the last specified user_time,
        which can happen if the clock goes backwards, we erase the last
        specified user_time */
@@ -311,6 +356,53 @@ static void event_hack_mods(XEvent *e)
     }
 }
 
+static void event_track_pointer(XEvent *e)
+{
+    Window root;
+    Bool same_screen;
+    gint x, y;
+
+    /* events sent by other clients can't be trusted */
+    if (e->xany.send_event) return;
+
+    switch (e->type) {
+    case ButtonPress:
+    case ButtonRelease:
+        root = e->xbutton.root;
+        same_screen = e->xbutton.same_screen;
+        x = e->xbutton.x_root;
+        y = e->xbutton.y_root;
+        break;
+    case KeyPress:
+    case KeyRelease:
+        root = e->xkey.root;
+        same_screen = e->xkey.same_screen;
+        x = e->xkey.x_root;
+        y = e->xkey.y_root;
+        break;
+    case MotionNotify:
+        root = e->xmotion.root;
+        same_screen = e->xmotion.same_screen;
+        x = e->xmotion.x_root;
+        y = e->xmotion.y_root;
+        break;
+    case EnterNotify:
+    case LeaveNotify:
+        root = e->xcrossing.root;
+        same_screen = e->xcrossing.same_screen;
+        x = e->xcrossing.x_root;
+        y = e->xcrossing.y_root;
+        break;
+    default:
+        return;
+    }
+
+    if (same_screen && root == obt_root(ob_screen))
+        screen_pointer_seen(x, y);
+    else
+        screen_pointer_forget();
+}
+
 static gboolean wanted_focusevent(XEvent *e, gboolean in_client_only)
 {
     gint mode = e->xfocus.mode;
@@ -493,7 +585,10 @@ static void event_process(const XEvent *ec, gpointer data)
 
     event_set_curtime(e);
     event_curserial = e->xany.serial;
+    event_curtime_local = local_time_ms();
     event_hack_mods(e);
+    /* the motion is compressed now, so this is the latest position */
+    event_track_pointer(e);
 
     /* deal with it in the kernel */
 
@@ -634,10 +729,18 @@ static void event_process(const XEvent *ec, gpointer data)
         event_handle_root(e);
     else if (e->type == MapRequest)
         window_manage(window);
+#ifdef XKB
+    else if (obt_display_extension_xkb &&
+             e->type == obt_display_extension_xkb_basep)
+        event_handle_xkb(e);
+#endif
     else if (e->type == MappingNotify) {
         /* keyboard layout changes for modifier mapping changes. reload the
            modifier map, and rebind all the key bindings as appropriate */
-        if (config_keyboard_rebind_on_mapping_notify) {
+        if (config_keyboard_rebind_on_mapping_notify &&
+            e->xmapping.request != MappingPointer &&
+            !obt_display_extension_xkb)
+        {
             ob_debug("Keyboard map changed. Reloading keyboard bindings.");
             ob_set_state(OB_STATE_RECONFIGURING);
             obt_keyboard_reload();
@@ -743,7 +846,51 @@ static void event_process(const XEvent *ec, gpointer data)
        the time, so clear it here until the next event is handled */
     event_curtime = event_sourcetime = CurrentTime;
     event_curserial = 0;
+    event_curtime_local = 0;
+
+    /* the pointer can move without us hearing about it, unless it is
+       grabbed */
+    if (!grab_on_pointer())
+        screen_pointer_forget();
+}
+
+#ifdef XKB
+static void event_handle_xkb(XEvent *e)
+{
+    XkbEvent *xkb = (XkbEvent*)e;
+    gboolean changed;
+
+    if (!config_keyboard_rebind_on_mapping_notify) return;
+
+    switch (xkb->any.xkb_type) {
+    case XkbNewKeyboardNotify:
+        /* a different keyboard, so everything may be different */
+        ob_debug("Keyboard changed. Reloading keyboard bindings.");
+        obt_keyboard_reload();
+        changed = TRUE;
+        break;
+    case XkbMapNotify:
+        changed = obt_keyboard_update_keycodes(
+            xkb->map.first_key_sym,
+            (xkb->map.changed & XkbKeySymsMask) ? xkb->map.num_key_syms : 0,
+            !!(xkb->map.changed & XkbModifierMapMask));
+        if (changed)
+            ob_debug("Keyboard map changed for keycodes %d-%d. Reloading "
+                     "keyboard bindings.", xkb->map.first_key_sym,
+                     xkb->map.first_key_sym + xkb->map.num_key_syms - 1);
+        break;
+    default:
+        changed = FALSE;
+    }
+
+    if (changed) {
+        /* this only grabs keys again when their keycodes have changed */
+        ob_set_state(OB_STATE_RECONFIGURING);
+        keyboard_rebind();
+        ob_set_state(OB_STATE_RUNNING);
+    }
 }
+#endif
 
 static void event_handle_root(XEvent *e)
 {
@@ -2271,6 +2418,7 @@ gboolean find_timestamp(XEvent *e, gpointer data)
 {
     const Time t = event_get_timestamp(e);
     if (t && t >= event_curtime) {
+        update_server_time(e, t);
         event_curtime = t;
         return TRUE;
     }
@@ -2278,16 +2426,21 @@ gboolean find_timestamp(XEvent *e, gpointer data)
         return FALSE;
 }
 
-static Time next_time(void)
+static void probe_time(void)
 {
-    /* Some events don't come with timestamps :(
-       ...but we can get one anyways >:) */
-
     /* Generate a timestamp so there is guaranteed at least one in the queue
        eventually */
     XChangeProperty(obt_display, screen_support_win,
                     OBT_PROP_ATOM(WM_CLASS), OBT_PROP_ATOM(STRING),
                     8, PropModeAppend, NULL, 0);
+    event_servertime_probing = TRUE;
+}
+
+static Time next_time(void)
+{
+    /* Some events don't come with timestamps :(
+       ...but we can get one anyways >:) */
+    probe_time();
 
     /* Grab the first timestamp available */
     xqueue_exists(find_timestamp, NULL);
@@ -2302,9 +2455,46 @@ Time event_time(void)
 {
     if (event_curtime) return event_curtime;
 
+    /* a timestamp may have already arrived, which saves a round trip */
+    if (xqueue_exists_local(find_timestamp, NULL))
+        return event_curtime;
+
     return next_time();
 }
 
+Time event_time_estimate(void)
+{
+    if (event_curtime) return event_curtime;
+
+    if (xqueue_exists_local(find_timestamp, NULL))
+        return event_curtime;
+
+    /* nothing has given us a time yet, so we have to wait for one */
+    if (!event_servertime)
+        return next_time();
+
+    /* every event we process from here on will come at or after the last
+       timestamp we saw.  if that is getting old, ask for a fresh one without
+       waiting for it, so that it is ready by the next time we are asked */
+    if (!event_servertime_probing &&
+        /* if the clock went backwards, we can't tell how old it is */
+        (local_time_ms() < event_servertime_local ||
+         local_time_ms() - event_servertime_local > OB_EVENT_TIME_PROBE_DELAY))
+    {
+        probe_time();
+        XFlush(obt_display);
+    }
+
+    return event_servertime;
+}
+
+gint64 event_handling_ms(void)
+{
+    if (!event_curtime_local) return -1;
+    /* the clock may have gone backwards */
+    return MAX(0, local_time_ms() - event_curtime_local);
+}
+
 Time event_source_time(void)
 {
     return event_sourcetime;
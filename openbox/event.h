@@ -27,6 +27,9 @@ struct _ObClient;
 /*! The amount of time before a window appears that is checked for user input
     to determine if the user is working in another window */
 #define OB_EVENT_USER_TIME_DELAY (1000) /* milliseconds */
+/*! How old the last seen server timestamp can get before
+    event_time_estimate() asks the server for a new one */
+#define OB_EVENT_TIME_PROBE_DELAY (500) /* milliseconds */
 
 /*! The last user-interaction time, as given by the clients */
 extern Time event_last_user_time;
@@ -69,10 +72,25 @@ gboolean event_time_after(guint32 t1, guint32 t2);
 */
 Time event_time(void);
 
+/*! Like event_time(), but never waits on the server when any timestamp has
+  been seen before.  If the current event has no time, this returns the latest
+  timestamp seen on any event, which is at or before any other events we will
+  process, but may be earlier than the current time on the server.  Use it
+  where the time is only compared against other timestamps, and use
+  event_time() for requests which the server checks against its own clock,
+  like focus and grabs, and where it stands for the current time, like
+  deciding if a window may steal focus.
+*/
+Time event_time_estimate(void);
+
 /*! Force event_time() to skip the current timestamp and look for the next
   one. */
 void event_reset_time(void);
 
+/*! How long ago, in milliseconds, we began handling the current X event, or
+  -1 if no event is being handled */
+gint64 event_handling_ms(void);
+
 /*! A time at which an event happened that caused this current event to be
   generated.  This is a user-provided time and not to be trusted.
   Returns CurrentTime if there was no source time provided.
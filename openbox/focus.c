@@ -29,6 +29,8 @@
 #include "keyboard.h"
 #include "focus.h"
 #include "stacking.h"
+#include "ipc.h"
+#include "publish.h"
 #include "obt/prop.h"
 
 #include <X11/Xlib.h>
@@ -69,10 +71,16 @@ static void push_to_top(ObClient *client)
     focus_order = g_list_prepend(focus_order, client);
 }
 
-void focus_set_client(ObClient *client)
+static void focus_write_active(void)
 {
-    Window active;
+    /* preserve the NET_ACTIVE_WINDOW hint on shutdown */
+    if (ob_state() != OB_STATE_EXITING)
+        OBT_PROP_SET32(obt_root(ob_screen), NET_ACTIVE_WINDOW, WINDOW,
+                       focus_client ? focus_client->window : None);
+}
 
+void focus_set_client(ObClient *client)
+{
     ob_debug_type(OB_DEBUG_FOCUS,
                   "focus_set_client 0x%lx", client ? client->window : 0);
 
@@ -95,11 +103,9 @@ void focus_set_client(ObClient *client)
         focus_cycle_reorder();
     }
 
-    /* set the NET_ACTIVE_WINDOW hint, but preserve it on shutdown */
-    if (ob_state() != OB_STATE_EXITING) {
-        active = client ? client->window : None;
-        OBT_PROP_SET32(obt_root(ob_screen), NET_ACTIVE_WINDOW, WINDOW, active);
-    }
+    /* set the NET_ACTIVE_WINDOW hint */
+    publish_later(focus_write_active);
+    ipc_focus_changed(client);
 
     /* when focus is moved to a new window, the last_user_time timestamp would
        no longer be valid, as it applies for the focused window */
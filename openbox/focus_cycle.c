@@ -23,6 +23,7 @@
 #include "frame.h"
 #include "focus.h"
 #include "screen.h"
+#include "spatial.h"
 #include "openbox.h"
 #include "debug.h"
 
@@ -181,8 +182,10 @@ static ObClient *focus_find_directional(ObClient *c, ObDirection dir,
     gint offset = 0;
     gint distance = 0;
     gint score, best_score;
+    gint radius;
     ObClient *best_client, *cur;
-    GList *it;
+    GSList *it, *found;
+    Rect near;
 
     if (!client_list)
         return NULL;
@@ -194,74 +197,90 @@ static ObClient *focus_find_directional(ObClient *c, ObDirection dir,
     best_score = -1;
     best_client = c;
 
-    for (it = g_list_first(client_list); it; it = g_list_next(it)) {
-        cur = it->data;
-
-        /* the currently selected window isn't interesting */
-        if (cur == c)
-            continue;
-        if (!focus_cycle_valid(it->data))
-            continue;
-
-        /* find the centre coords of this window, from the
-         * currently focused window's point of view */
-        his_cx = (cur->frame->area.x - my_cx)
-            + cur->frame->area.width / 2;
-        his_cy = (cur->frame->area.y - my_cy)
-            + cur->frame->area.height / 2;
-
-        if (dir == OB_DIRECTION_NORTHEAST || dir == OB_DIRECTION_SOUTHEAST ||
-            dir == OB_DIRECTION_SOUTHWEST || dir == OB_DIRECTION_NORTHWEST)
-        {
-            gint tx;
-            /* Rotate the diagonals 45 degrees counterclockwise.
-             * To do this, multiply the matrix /+h +h\ with the
-             * vector (x y).                   \-h +h/
-             * h = sqrt(0.5). We can set h := 1 since absolute
-             * distance doesn't matter here. */
-            tx = his_cx + his_cy;
-            his_cy = -his_cx + his_cy;
-            his_cx = tx;
-        }
+    /* look at the windows near us first, and then further away.  a window
+       which was not found has its centre more than the radius away from ours,
+       so its score would be more than the radius too */
+    for (radius = 256; ; radius *= 2) {
+        RECT_SET(near, my_cx - radius, my_cy - radius,
+                 radius * 2 + 1, radius * 2 + 1);
+        found = spatial_find_rect(&near, screen_desktop, TRUE);
+
+        for (it = found; it; it = g_slist_next(it)) {
+            cur = it->data;
+
+            /* the currently selected window isn't interesting */
+            if (cur == c)
+                continue;
+            if (!focus_cycle_valid(cur))
+                continue;
+
+            /* find the centre coords of this window, from the
+             * currently focused window's point of view */
+            his_cx = (cur->frame->area.x - my_cx)
+                + cur->frame->area.width / 2;
+            his_cy = (cur->frame->area.y - my_cy)
+                + cur->frame->area.height / 2;
+
+            if (dir == OB_DIRECTION_NORTHEAST ||
+                dir == OB_DIRECTION_SOUTHEAST ||
+                dir == OB_DIRECTION_SOUTHWEST ||
+                dir == OB_DIRECTION_NORTHWEST)
+            {
+                gint tx;
+                /* Rotate the diagonals 45 degrees counterclockwise.
+                 * To do this, multiply the matrix /+h +h\ with the
+                 * vector (x y).                   \-h +h/
+                 * h = sqrt(0.5). We can set h := 1 since absolute
+                 * distance doesn't matter here. */
+                tx = his_cx + his_cy;
+                his_cy = -his_cx + his_cy;
+                his_cx = tx;
+            }
 
-        switch (dir) {
-        case OB_DIRECTION_NORTH:
-        case OB_DIRECTION_SOUTH:
-        case OB_DIRECTION_NORTHEAST:
-        case OB_DIRECTION_SOUTHWEST:
-            offset = (his_cx < 0) ? -his_cx : his_cx;
-            distance = ((dir == OB_DIRECTION_NORTH ||
-                         dir == OB_DIRECTION_NORTHEAST) ?
-                        -his_cy : his_cy);
-            break;
-        case OB_DIRECTION_EAST:
-        case OB_DIRECTION_WEST:
-        case OB_DIRECTION_SOUTHEAST:
-        case OB_DIRECTION_NORTHWEST:
-            offset = (his_cy < 0) ? -his_cy : his_cy;
-            distance = ((dir == OB_DIRECTION_WEST ||
-                         dir == OB_DIRECTION_NORTHWEST) ?
-                        -his_cx : his_cx);
-            break;
-        }
+            switch (dir) {
+            case OB_DIRECTION_NORTH:
+            case OB_DIRECTION_SOUTH:
+            case OB_DIRECTION_NORTHEAST:
+            case OB_DIRECTION_SOUTHWEST:
+                offset = (his_cx < 0) ? -his_cx : his_cx;
+                distance = ((dir == OB_DIRECTION_NORTH ||
+                             dir == OB_DIRECTION_NORTHEAST) ?
+                            -his_cy : his_cy);
+                break;
+            case OB_DIRECTION_EAST:
+            case OB_DIRECTION_WEST:
+            case OB_DIRECTION_SOUTHEAST:
+            case OB_DIRECTION_NORTHWEST:
+                offset = (his_cy < 0) ? -his_cy : his_cy;
+                distance = ((dir == OB_DIRECTION_WEST ||
+                             dir == OB_DIRECTION_NORTHWEST) ?
+                            -his_cx : his_cx);
+                break;
+            }
 
-        /* the target must be in the requested direction */
-        if (distance <= 0)
-            continue;
+            /* the target must be in the requested direction */
+            if (distance <= 0)
+                continue;
 
-        /* Calculate score for this window.  The smaller the better. */
-        score = distance + offset;
+            /* Calculate score for this window.  The smaller the better. */
+            score = distance + offset;
 
-        /* windows more than 45 degrees off the direction are
-         * heavily penalized and will only be chosen if nothing
-         * else within a million pixels */
-        if (offset > distance)
-            score += 1000000;
+            /* windows more than 45 degrees off the direction are
+             * heavily penalized and will only be chosen if nothing
+             * else within a million pixels */
+            if (offset > distance)
+                score += 1000000;
 
-        if (best_score == -1 || score < best_score) {
-            best_client = cur;
-            best_score = score;
+            if (best_score == -1 || score < best_score) {
+                best_client = cur;
+                best_score = score;
+            }
         }
+        g_slist_free(found);
+
+        if ((best_score != -1 && best_score <= radius) ||
+            RECT_CONTAINS_RECT(near, *screen_physical_area_all_monitors()))
+            break;
     }
 
     return best_client;
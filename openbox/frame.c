@@ -28,6 +28,7 @@
 #include "focus_cycle_indicator.h"
 #include "moveresize.h"
 #include "screen.h"
+#include "spatial.h"
 #include "obrender/theme.h"
 #include "obt/display.h"
 #include "obt/xqueue.h"
@@ -228,6 +229,7 @@ static void free_theme_statics(ObFrame *self)
 
 void frame_free(ObFrame *self)
 {
+    spatial_remove(self->client);
     free_theme_statics(self);
 
     XDestroyWindow(obt_display, self->window);
@@ -885,6 +887,10 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
         XResizeWindow(obt_display, self->label, self->label_width,
                       ob_rr_theme->label_height);
     }
+
+    /* fake clients are not kept in the grid */
+    if (self->client->managed)
+        spatial_update(self->client);
 }
 
 static void frame_adjust_cursors(ObFrame *self)
@@ -90,6 +90,12 @@ struct _ObFrame
     Rect      area;
     gboolean  visible;
 
+    /*! The monitor the frame is on, as found for monitor_area while
+      screen_monitors_serial was monitor_serial */
+    guint     monitor;
+    Rect      monitor_area;
+    guint     monitor_serial;
+
     guint     functions;
     guint     decorations;
 
@@ -127,6 +127,8 @@ gboolean grab_pointer_full(gboolean grab, gboolean owner_events,
     } else if (pgrabs > 0) {
         if (--pgrabs == 0) {
             XUngrabPointer(obt_display, ungrab_time());
+            /* motion is not all sent to us anymore */
+            screen_pointer_forget();
         }
         ret = TRUE;
     }
@@ -195,8 +197,6 @@ void grab_button_full(guint button, guint state, Window win, guint mask,
         XGrabButton(obt_display, button, state | mask_list[i], win, False,
                     mask, pointer_mode, GrabModeAsync, None, ob_cursor(cur));
     obt_display_ignore_errors(FALSE);
-    if (obt_display_error_occured)
-        ob_debug("Failed to grab button %d modifiers %d", button, state);
 }
 
 void ungrab_button(guint button, guint state, Window win)
@@ -217,8 +217,14 @@ void grab_key(guint keycode, guint state, Window win, gint keyboard_mode)
         XGrabKey(obt_display, keycode, state | mask_list[i], win, FALSE,
                  GrabModeAsync, keyboard_mode);
     obt_display_ignore_errors(FALSE);
-    if (obt_display_error_occured)
-        ob_debug("Failed to grab keycode %d modifiers %d", keycode, state);
+}
+
+void ungrab_key(guint keycode, guint state, Window win)
+{
+    guint i;
+
+    for (i = 0; i < MASK_LIST_SIZE; ++i)
+        XUngrabKey(obt_display, keycode, state | mask_list[i], win);
 }
 
 void ungrab_all_keys(Window win)
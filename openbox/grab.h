@@ -49,6 +49,7 @@ void grab_button_full(guint button, guint state, Window win, guint mask,
 void ungrab_button(guint button, guint state, Window win);
 
 void grab_key(guint keycode, guint state, Window win, gint keyboard_mode);
+void ungrab_key(guint keycode, guint state, Window win);
 
 void ungrab_all_keys(Window win);
 
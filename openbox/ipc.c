@@ -0,0 +1,770 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   ipc.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "ipc.h"
+#include "openbox.h"
+#include "actions.h"
+#include "client.h"
+#include "focus.h"
+#include "stacking.h"
+#include "window.h"
+#include "debug.h"
+#include "obt/display.h"
+#include "obt/paths.h"
+#include "obt/prop.h"
+#include "obt/xml.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+/*! How many connections can be waiting to be accepted */
+#define IPC_BACKLOG 8
+/*! A subscriber which falls this far behind on reading events is dropped */
+#define IPC_MAX_PENDING (1024 * 1024)
+
+/* a write to a connection which has gone away must not raise SIGPIPE, which
+   would make us exit.  where send() can't be told that, the socket is. */
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+typedef struct _ObIpcConn ObIpcConn;
+
+struct _ObIpcConn {
+    GIOChannel *chan;
+    guint read_id;
+    guint write_id;
+    ObtXmlInst *inst;
+    /*! FALSE once the request is found to not be valid xml */
+    gboolean valid;
+    /*! Replies which have not been written to the socket yet */
+    GString *out;
+    /*! Close the connection once the replies are written */
+    gboolean closing;
+    /*! The ObIpcEvent types it subscribed to */
+    guint events;
+    /*! Set while its requests are being run, when it can't be freed */
+    gboolean busy;
+    /*! Set when it was closed while busy, to be freed when it is done */
+    gboolean dead;
+};
+
+static gchar *socket_path = NULL;
+/*! The socket that was created, so another one with the same path is not
+  removed */
+static struct stat socket_stat;
+static GIOChannel *listen_chan = NULL;
+static guint listen_id = 0;
+static GSList *connections = NULL;
+/*! The connections which have subscribed to events */
+static GSList *subscribers = NULL;
+/*! The window ids of the clients the subscribers know about */
+static GHashTable *known_clients = NULL;
+/*! The last stacking order given, from bottom to top.  It is only kept up
+  to date while someone is subscribed to the stacking order */
+static gulong *stacking = NULL;
+static guint n_stacking = 0;
+
+static const struct {
+    const gchar *name;
+    ObIpcEvent event;
+} event_names[] = {
+    { "clients", OB_IPC_EVENT_CLIENTS },
+    { "geometry", OB_IPC_EVENT_GEOMETRY },
+    { "desktop", OB_IPC_EVENT_DESKTOP },
+    { "focus", OB_IPC_EVENT_FOCUS },
+    { "stacking", OB_IPC_EVENT_STACKING },
+    { "title", OB_IPC_EVENT_TITLE }
+};
+
+static void conn_free(ObIpcConn *c)
+{
+    /* its batch may send events to itself, so wait until it is done */
+    if (c->busy) {
+        c->dead = TRUE;
+        subscribers = g_slist_remove(subscribers, c);
+        return;
+    }
+
+    if (c->read_id) g_source_remove(c->read_id);
+    if (c->write_id) g_source_remove(c->write_id);
+    g_io_channel_unref(c->chan);
+
+    /* don't run anything which is left in the parser */
+    obt_xml_unregister(c->inst, "batch");
+    obt_xml_unregister(c->inst, "subscribe");
+    obt_xml_stream_end(c->inst);
+    obt_xml_instance_unref(c->inst);
+
+    g_string_free(c->out, TRUE);
+    connections = g_slist_remove(connections, c);
+    subscribers = g_slist_remove(subscribers, c);
+    g_slice_free(ObIpcConn, c);
+}
+
+static gboolean conn_write(GIOChannel *chan, GIOCondition cond, gpointer data);
+
+/*! Write as much of the replies as the socket will take.  Returns FALSE if
+  the connection was closed. */
+static gboolean conn_flush(ObIpcConn *c)
+{
+    gint fd = g_io_channel_unix_get_fd(c->chan);
+    gboolean gone = FALSE;
+    gssize n;
+
+    if (c->dead) return FALSE;
+
+    while (c->out->len && !gone) {
+        n = send(fd, c->out->str, c->out->len, MSG_NOSIGNAL);
+        if (n >= 0)
+            g_string_erase(c->out, 0, n);
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break; /* the socket is full */
+        else if (errno != EINTR)
+            /* like EPIPE, when it closed without reading its replies */
+            gone = TRUE;
+    }
+
+    if (gone || (!c->out->len && c->closing)) {
+        conn_free(c);
+        return FALSE;
+    }
+
+    /* wait for the socket to take the rest */
+    if (c->out->len && !c->write_id)
+        c->write_id = g_io_add_watch(c->chan, G_IO_OUT | G_IO_ERR | G_IO_HUP,
+                                     conn_write, c);
+    else if (!c->out->len && c->write_id) {
+        g_source_remove(c->write_id);
+        c->write_id = 0;
+    }
+    return TRUE;
+}
+
+static gboolean conn_write(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    ObIpcConn *c = data;
+
+    if (cond & (G_IO_ERR | G_IO_HUP)) {
+        c->write_id = 0;
+        conn_free(c);
+        return FALSE; /* the source was removed */
+    }
+
+    if (conn_flush(c) && c->write_id)
+        return TRUE; /* keep writing */
+    return FALSE;
+}
+
+static void reply_error(GSList **errors, const gchar *format, ...)
+{
+    va_list vl;
+
+    va_start(vl, format);
+    *errors = g_slist_append(*errors, g_markup_vprintf_escaped(format, vl));
+    va_end(vl);
+}
+
+static ObActionsAct* parse_action(xmlNodePtr node, GSList **errors)
+{
+    ObActionsAct *act;
+    gchar *name;
+
+    if (!(act = actions_parse(node))) {
+        if (obt_xml_attr_string(node, "name", &name)) {
+            reply_error(errors, "Invalid action \"%s\"", name);
+            g_free(name);
+        }
+        else
+            reply_error(errors, "Missing action name");
+    }
+    return act;
+}
+
+/*! Parse the actions inside @node.  Returns a list of ObActionsAct */
+static GSList* parse_actions(xmlNodePtr node, GSList **errors)
+{
+    xmlNodePtr n;
+    GSList *acts = NULL;
+
+    for (n = obt_xml_find_node(node->children, "action"); n;
+         n = obt_xml_find_node(n->next, "action"))
+    {
+        ObActionsAct *act = parse_action(n, errors);
+        if (act)
+            acts = g_slist_append(acts, act);
+    }
+    return acts;
+}
+
+/*! Find the client with the window id in the @node's @attr attribute.
+  Returns FALSE if the attribute is present but doesn't name a client. */
+static gboolean find_client(xmlNodePtr node, const gchar *attr,
+                            ObClient **client, GSList **errors)
+{
+    gchar *s, *end;
+    Window xwin;
+    ObWindow *win;
+
+    *client = NULL;
+    if (!obt_xml_attr_string(node, attr, &s))
+        return TRUE;
+
+    xwin = strtoul(s, &end, 0);
+    if (!s[0] || *end || !(win = window_find(xwin)) || !WINDOW_IS_CLIENT(win))
+    {
+        reply_error(errors, "No window \"%s\"", s);
+        g_free(s);
+        return FALSE;
+    }
+    g_free(s);
+
+    *client = WINDOW_AS_CLIENT(win);
+    return TRUE;
+}
+
+/*! Run the actions and free them.  Returns how many were run. */
+static guint run_actions(GSList *acts, ObClient *client)
+{
+    GSList *it;
+    guint n;
+
+    if (!acts) return 0;
+
+    actions_run_acts(acts, OB_USER_ACTION_NONE, 0, -1, -1, 0,
+                     OB_FRAME_CONTEXT_NONE, client);
+
+    n = g_slist_length(acts);
+    for (it = acts; it; it = g_slist_next(it))
+        actions_act_unref(it->data);
+    g_slist_free(acts);
+    return n;
+}
+
+static void run_batch(xmlNodePtr node, gpointer data)
+{
+    ObIpcConn *c = data;
+    ObClient *target;
+    gboolean target_ok;
+    GSList *acts = NULL, *errors = NULL, *it;
+    xmlNodePtr n;
+    gchar *id;
+    guint ran = 0;
+
+    target_ok = find_client(node, "window", &target, &errors);
+
+    /* run everything in the order it was given, the actions for the batch's
+       window are gathered up until a <window> comes along */
+    for (n = node->children; n; n = n->next) {
+        if (n->type != XML_ELEMENT_NODE)
+            continue;
+        else if (!xmlStrcmp(n->name, (const xmlChar*)"action")) {
+            ObActionsAct *act = parse_action(n, &errors);
+
+            if (act && target_ok)
+                acts = g_slist_append(acts, act);
+            else if (act)
+                actions_act_unref(act);
+        }
+        else if (!xmlStrcmp(n->name, (const xmlChar*)"window")) {
+            ObClient *client;
+
+            ran += run_actions(acts, target);
+            acts = NULL;
+
+            if (find_client(n, "id", &client, &errors)) {
+                if (client)
+                    ran += run_actions(parse_actions(n, &errors), client);
+                else
+                    reply_error(&errors, "Missing window id");
+            }
+        }
+        else
+            reply_error(&errors, "Unknown element \"%s\"",
+                        (const gchar*)n->name);
+    }
+    ran += run_actions(acts, target);
+
+    g_string_append(c->out, "<reply");
+    if (obt_xml_attr_string(node, "id", &id)) {
+        gchar *s = g_markup_printf_escaped(" id=\"%s\"", id);
+        g_string_append(c->out, s);
+        g_free(s);
+        g_free(id);
+    }
+    g_string_append_printf(c->out, " actions=\"%u\" errors=\"%u\"",
+                           ran, g_slist_length(errors));
+    if (errors) {
+        g_string_append_c(c->out, '>');
+        for (it = errors; it; it = g_slist_next(it)) {
+            g_string_append_printf(c->out, "<error>%s</error>",
+                                   (gchar*)it->data);
+            g_free(it->data);
+        }
+        g_slist_free(errors);
+        g_string_append(c->out, "</reply>\n");
+    }
+    else
+        g_string_append(c->out, "/>\n");
+}
+
+static void append_client(GString *out, ObClient *c)
+{
+    gchar *s;
+
+    s = g_markup_printf_escaped("<add window=\"0x%lx\" desktop=\"%u\" "
+                                "x=\"%d\" y=\"%d\" width=\"%d\" "
+                                "height=\"%d\" title=\"%s\"/>\n",
+                                c->window, c->desktop,
+                                c->frame->area.x, c->frame->area.y,
+                                c->frame->area.width, c->frame->area.height,
+                                c->title ? c->title : "");
+    g_string_append(out, s);
+    g_free(s);
+}
+
+static void append_stacking(GString *out)
+{
+    guint i;
+
+    g_string_append(out, "<stacking windows=\"");
+    for (i = 0; i < n_stacking; ++i)
+        g_string_append_printf(out, i ? " 0x%lx" : "0x%lx", stacking[i]);
+    g_string_append(out, "\"/>\n");
+}
+
+static void subscribe(xmlNodePtr node, gpointer data)
+{
+    ObIpcConn *c = data;
+    gchar *s;
+    guint i;
+    gboolean stacking_known;
+
+    stacking_known = ipc_has_subscribers(OB_IPC_EVENT_STACKING);
+
+    c->events = 0;
+    if (obt_xml_attr_string(node, "events", &s)) {
+        gchar **names = g_strsplit_set(s, " ,", 0), **it;
+
+        for (it = names; *it; ++it)
+            for (i = 0; i < G_N_ELEMENTS(event_names); ++i)
+                if (!strcmp(*it, event_names[i].name))
+                    c->events |= event_names[i].event;
+        g_strfreev(names);
+        g_free(s);
+    }
+    else
+        c->events = OB_IPC_EVENT_ALL;
+
+    if (!c->events) {
+        g_string_append(c->out, "<reply actions=\"0\" errors=\"1\">"
+                        "<error>No events to subscribe to</error></reply>\n");
+        return;
+    }
+
+    /* start keeping track of the clients to find the added and removed
+       ones, they aren't followed while there are no subscribers */
+    if (!subscribers) {
+        GList *it;
+
+        if (known_clients)
+            g_hash_table_remove_all(known_clients);
+        else
+            known_clients = g_hash_table_new(g_direct_hash, g_direct_equal);
+        for (it = client_list; it; it = g_list_next(it)) {
+            ObClient *client = it->data;
+            g_hash_table_insert(known_clients,
+                                GUINT_TO_POINTER(client->window),
+                                GUINT_TO_POINTER(1));
+        }
+    }
+    if (!g_slist_find(subscribers, c))
+        subscribers = g_slist_prepend(subscribers, c);
+
+    /* the current state, from which the events follow */
+    if (c->events & OB_IPC_EVENT_CLIENTS) {
+        GList *it;
+
+        for (it = client_list; it; it = g_list_next(it))
+            append_client(c->out, it->data);
+    }
+    if (c->events & OB_IPC_EVENT_FOCUS)
+        g_string_append_printf(c->out, "<focus window=\"0x%lx\"/>\n",
+                               focus_client ? focus_client->window : 0);
+    if (c->events & OB_IPC_EVENT_STACKING) {
+        if (!stacking_known) {
+            g_free(stacking);
+            stacking = stacking_windows(&n_stacking);
+        }
+        append_stacking(c->out);
+    }
+}
+
+/*! Give an event to the subscribers which want it */
+static void send_event(ObIpcEvent event, const gchar *line)
+{
+    GSList *it, *next;
+
+    for (it = subscribers; it; it = next) {
+        ObIpcConn *c = it->data;
+
+        next = g_slist_next(it);
+        if (!(c->events & event)) continue;
+
+        if (c->out->len > IPC_MAX_PENDING) {
+            ob_debug("Dropping an IPC subscriber which is not reading");
+            conn_free(c);
+            continue;
+        }
+        g_string_append(c->out, line);
+        conn_flush(c);
+    }
+}
+
+static gboolean send_removed(gpointer key, gpointer value, gpointer data)
+{
+    GHashTable *current = data;
+    gchar *s;
+
+    if (g_hash_table_lookup(current, key))
+        return FALSE; /* still here */
+
+    s = g_strdup_printf("<remove window=\"0x%lx\"/>\n",
+                        (gulong)GPOINTER_TO_UINT(key));
+    send_event(OB_IPC_EVENT_CLIENTS, s);
+    g_free(s);
+    return TRUE; /* forget it */
+}
+
+gboolean ipc_has_subscribers(ObIpcEvent events)
+{
+    GSList *it;
+
+    for (it = subscribers; it; it = g_slist_next(it))
+        if (((ObIpcConn*)it->data)->events & events)
+            return TRUE;
+    return FALSE;
+}
+
+void ipc_client_list_changed(void)
+{
+    GHashTable *current;
+    GList *it;
+
+    if (!subscribers) return;
+
+    current = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (it = client_list; it; it = g_list_next(it)) {
+        ObClient *c = it->data;
+        gpointer key = GUINT_TO_POINTER(c->window);
+
+        g_hash_table_insert(current, key, GUINT_TO_POINTER(1));
+        if (!g_hash_table_lookup(known_clients, key)) {
+            GString *s = g_string_new(NULL);
+
+            g_hash_table_insert(known_clients, key, GUINT_TO_POINTER(1));
+            append_client(s, c);
+            send_event(OB_IPC_EVENT_CLIENTS, s->str);
+            g_string_free(s, TRUE);
+        }
+    }
+    g_hash_table_foreach_remove(known_clients, send_removed, current);
+    g_hash_table_destroy(current);
+}
+
+void ipc_client_changed(ObClient *c, ObIpcEvent what)
+{
+    gchar *s;
+
+    if (!subscribers || !c->managed) return;
+
+    switch (what) {
+    case OB_IPC_EVENT_GEOMETRY:
+        s = g_strdup_printf("<geometry window=\"0x%lx\" x=\"%d\" y=\"%d\" "
+                            "width=\"%d\" height=\"%d\"/>\n", c->window,
+                            c->frame->area.x, c->frame->area.y,
+                            c->frame->area.width, c->frame->area.height);
+        break;
+    case OB_IPC_EVENT_DESKTOP:
+        s = g_strdup_printf("<desktop window=\"0x%lx\" desktop=\"%u\"/>\n",
+                            c->window, c->desktop);
+        break;
+    case OB_IPC_EVENT_TITLE:
+        s = g_markup_printf_escaped("<title window=\"0x%lx\" "
+                                    "title=\"%s\"/>\n", c->window,
+                                    c->title ? c->title : "");
+        break;
+    default:
+        g_assert_not_reached();
+        return;
+    }
+    send_event(what, s);
+    g_free(s);
+}
+
+void ipc_focus_changed(ObClient *c)
+{
+    gchar *s;
+
+    if (!subscribers) return;
+
+    s = g_strdup_printf("<focus window=\"0x%lx\"/>\n", c ? c->window : 0);
+    send_event(OB_IPC_EVENT_FOCUS, s);
+    g_free(s);
+}
+
+void ipc_stacking_changed(const gulong *windows, guint n)
+{
+    GString *s;
+
+    if (n == n_stacking &&
+        (!n || !memcmp(windows, stacking, n * sizeof(gulong))))
+        return; /* no change */
+
+    /* remember it for new subscribers */
+    g_free(stacking);
+    stacking = n ? g_memdup(windows, n * sizeof(gulong)) : NULL;
+    n_stacking = n;
+
+    if (!subscribers) return;
+
+    s = g_string_new(NULL);
+    append_stacking(s);
+    send_event(OB_IPC_EVENT_STACKING, s->str);
+    g_string_free(s, TRUE);
+}
+
+static gboolean conn_read(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    ObIpcConn *c = data;
+    gchar buf[4096];
+    gsize n = 0;
+    GIOStatus st = G_IO_STATUS_EOF;
+
+    c->busy = TRUE;
+    if (cond & G_IO_IN)
+        do {
+            st = g_io_channel_read_chars(c->chan, buf, sizeof(buf), &n, NULL);
+            if (n && c->valid)
+                c->valid = obt_xml_stream_feed(c->inst, buf, n);
+        } while (st == G_IO_STATUS_NORMAL && n == sizeof(buf) && c->valid &&
+                 !c->dead);
+    c->busy = FALSE;
+
+    if (c->dead) {
+        /* it was closed while running its requests */
+        conn_free(c);
+        return FALSE; /* the source was removed */
+    }
+
+    if (!c->valid) {
+        g_string_append(c->out, "<reply actions=\"0\" errors=\"1\">"
+                        "<error>Invalid request</error></reply>\n");
+        st = G_IO_STATUS_EOF;
+    }
+
+    if (st == G_IO_STATUS_EOF || st == G_IO_STATUS_ERROR) {
+        /* stop reading, and go away once the replies are sent.  this ends
+           a subscription too, as the other end is closed or closing */
+        c->read_id = 0;
+        c->closing = TRUE;
+        subscribers = g_slist_remove(subscribers, c);
+        conn_flush(c);
+        return FALSE;
+    }
+
+    if (!conn_flush(c))
+        return FALSE; /* the connection was closed */
+    return TRUE; /* keep reading */
+}
+
+static gboolean conn_accept(GIOChannel *chan, GIOCondition cond,
+                            gpointer data)
+{
+    ObIpcConn *c;
+    gint fd;
+
+    fd = accept(g_io_channel_unix_get_fd(chan), NULL, NULL);
+    if (fd < 0)
+        return TRUE; /* keep listening */
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    {
+        gint on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    }
+#endif
+
+    c = g_slice_new0(ObIpcConn);
+    c->chan = g_io_channel_unix_new(fd);
+    g_io_channel_set_close_on_unref(c->chan, TRUE);
+    g_io_channel_set_encoding(c->chan, NULL, NULL);
+    g_io_channel_set_buffered(c->chan, FALSE);
+    g_io_channel_set_flags(c->chan, G_IO_FLAG_NONBLOCK, NULL);
+    c->read_id = g_io_add_watch(c->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                conn_read, c);
+    c->out = g_string_new(NULL);
+    c->valid = TRUE;
+
+    /* each batch is run as soon as all of it has arrived */
+    c->inst = obt_xml_instance_new();
+    obt_xml_register(c->inst, "batch", run_batch, c);
+    obt_xml_register(c->inst, "subscribe", subscribe, c);
+    obt_xml_stream_begin(c->inst, "openbox_ipc");
+
+    connections = g_slist_prepend(connections, c);
+    return TRUE; /* keep listening */
+}
+
+static gchar* socket_name(void)
+{
+    gchar *name, *p;
+
+    /* a display can be a path on some systems */
+    name = g_strdup_printf("openbox-%s-%d", DisplayString(obt_display),
+                           ob_screen);
+    for (p = name; *p; ++p)
+        if (*p == G_DIR_SEPARATOR) *p = '_';
+    return name;
+}
+
+static gint open_socket(const gchar *path)
+{
+    struct sockaddr_un addr;
+    gint fd;
+    mode_t mask;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        g_message("The path for the IPC socket is too long: %s", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        g_message("Unable to create the IPC socket");
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    /* only one window manager can run on the screen, so this was left behind
+       by one which didn't exit cleanly */
+    unlink(path);
+
+    /* only the user can connect to it */
+    mask = umask(0077);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, IPC_BACKLOG) < 0 ||
+        stat(path, &socket_stat) < 0)
+    {
+        umask(mask);
+        g_message("Unable to listen on the IPC socket %s", path);
+        close(fd);
+        return -1;
+    }
+    umask(mask);
+    return fd;
+}
+
+void ipc_startup(gboolean reconfig)
+{
+    ObtPaths *p;
+    gchar *name;
+    gint fd;
+
+    /* connections stay open through a reconfigure */
+    if (reconfig) return;
+
+    p = obt_paths_new();
+    if (!obt_paths_runtime_dir(p)) {
+        ob_debug("XDG_RUNTIME_DIR is not set, not listening for IPC");
+        obt_paths_unref(p);
+        return;
+    }
+
+    name = socket_name();
+    socket_path = g_build_filename(obt_paths_runtime_dir(p), name, NULL);
+    g_free(name);
+    obt_paths_unref(p);
+
+    if ((fd = open_socket(socket_path)) < 0) {
+        g_free(socket_path);
+        socket_path = NULL;
+        return;
+    }
+
+    listen_chan = g_io_channel_unix_new(fd);
+    g_io_channel_set_close_on_unref(listen_chan, TRUE);
+    listen_id = g_io_add_watch(listen_chan, G_IO_IN, conn_accept, NULL);
+
+    OBT_PROP_SETS(obt_root(ob_screen), OB_IPC_SOCKET, socket_path);
+    ob_debug("Listening for IPC on %s", socket_path);
+}
+
+void ipc_shutdown(gboolean reconfig)
+{
+    struct stat st;
+
+    if (reconfig) return;
+
+    while (connections)
+        conn_free(connections->data);
+
+    g_free(stacking);
+    stacking = NULL;
+    n_stacking = 0;
+    if (known_clients) {
+        g_hash_table_destroy(known_clients);
+        known_clients = NULL;
+    }
+
+    if (!socket_path) return;
+
+    g_source_remove(listen_id);
+    listen_id = 0;
+    g_io_channel_unref(listen_chan);
+    listen_chan = NULL;
+
+    /* a new window manager may have replaced it already */
+    if (stat(socket_path, &st) == 0 &&
+        st.st_dev == socket_stat.st_dev && st.st_ino == socket_stat.st_ino)
+    {
+        unlink(socket_path);
+        OBT_PROP_ERASE(obt_root(ob_screen), OB_IPC_SOCKET);
+    }
+
+    g_free(socket_path);
+    socket_path = NULL;
+}
+
+const gchar* ipc_socket_path(void)
+{
+    return socket_path;
+}
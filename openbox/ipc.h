@@ -0,0 +1,80 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   ipc.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ipc_h
+#define __ipc_h
+
+#include <glib.h>
+
+struct _ObClient;
+
+/*! The kinds of events which can be subscribed to */
+typedef enum {
+    OB_IPC_EVENT_CLIENTS  = 1 << 0, /*!< Clients being added and removed */
+    OB_IPC_EVENT_GEOMETRY = 1 << 1,
+    OB_IPC_EVENT_DESKTOP  = 1 << 2,
+    OB_IPC_EVENT_FOCUS    = 1 << 3,
+    OB_IPC_EVENT_STACKING = 1 << 4,
+    OB_IPC_EVENT_TITLE    = 1 << 5,
+    OB_IPC_EVENT_ALL      = (1 << 6) - 1
+} ObIpcEvent;
+
+/*! Listens on a unix socket in $XDG_RUNTIME_DIR for other programs to run
+  actions.  A connection sends an <openbox_ipc> document, and each <batch>
+  inside of it is run as soon as it arrives:
+
+  <openbox_ipc>
+    <batch id="1" window="0x1200003">
+      <action name="MoveResizeTo"><x>0</x><y>0</y></action>
+      <window id="0x1400005">
+        <action name="SendToDesktop"><desktop>2</desktop></action>
+      </window>
+    </batch>
+  </openbox_ipc>
+
+  The actions directly in the batch are run on its window, if it has one, and
+  the actions inside a <window> are run on that window.  Each batch gets one
+  reply line, like <reply id="1" actions="2" errors="0"/>, with an <error>
+  inside the reply for each problem found.
+
+  A <subscribe events="clients geometry desktop focus stacking title"/>
+  asks for changes to the windows to be sent as they happen, one line each,
+  starting with the current state, until the connection is closed.  Without
+  the events attribute, all of them are sent.  The lines are <add>, <remove>, <geometry>, <desktop>,
+  <title>, <focus> and <stacking>, and each names the window it is for.
+*/
+void ipc_startup(gboolean reconfig);
+void ipc_shutdown(gboolean reconfig);
+
+/*! Returns the path of the socket, or NULL if there is none */
+const gchar* ipc_socket_path(void);
+
+/*! Returns TRUE if a connection is subscribed to any of the @events, so the
+  caller can skip working out what changed when nobody would hear it */
+gboolean ipc_has_subscribers(ObIpcEvent events);
+
+/*! Call when the client_list changes, to find the added and removed clients */
+void ipc_client_list_changed(void);
+/*! Call when a client's geometry, desktop or title changes */
+void ipc_client_changed(struct _ObClient *c, ObIpcEvent what);
+void ipc_focus_changed(struct _ObClient *c);
+/*! Call with the stacking order of the clients, from bottom to top, when
+  ipc_has_subscribers(OB_IPC_EVENT_STACKING) */
+void ipc_stacking_changed(const gulong *windows, guint n);
+
+#endif
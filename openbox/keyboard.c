@@ -307,9 +307,45 @@ static void node_rebind(KeyBindingTree *node)
     if (node->next_sibling) node_rebind(node->next_sibling);
 }
 
+/*! Collect the keys which are grabbed at the top of the key binding tree */
+static GHashTable* top_level_keys(void)
+{
+    GHashTable *keys;
+    KeyBindingTree *p;
+
+    keys = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (p = keyboard_firstnode; p; p = p->next_sibling)
+        if (p->key)
+            g_hash_table_insert(keys, GUINT_TO_POINTER(p->state << 8 | p->key),
+                                p);
+    return keys;
+}
+
+static void ungrab_missing_key(gpointer key, gpointer value, gpointer keep)
+{
+    if (!g_hash_table_lookup(keep, key)) {
+        const guint k = GPOINTER_TO_UINT(key);
+        ungrab_key(k & 0xff, k >> 8, obt_root(ob_screen));
+    }
+}
+
+static void grab_missing_key(gpointer key, gpointer value, gpointer have)
+{
+    if (!g_hash_table_lookup(have, key)) {
+        const guint k = GPOINTER_TO_UINT(key);
+        grab_key(k & 0xff, k >> 8, obt_root(ob_screen), GrabModeAsync);
+    }
+}
+
 void keyboard_rebind(void)
 {
     KeyBindingTree *old;
+    GHashTable *before = NULL;
+
+    /* when we are not inside a chain, only the top level keys are grabbed,
+       so remember them and only touch the grabs for keys that change */
+    if (curpos == NULL)
+        before = top_level_keys();
 
     old = keyboard_firstnode;
     keyboard_firstnode = NULL;
@@ -317,8 +353,18 @@ void keyboard_rebind(void)
         node_rebind(old);
 
     tree_destroy(old);
-    set_curpos(NULL);
-    grab_keys(TRUE);
+
+    if (before) {
+        GHashTable *after = top_level_keys();
+
+        g_hash_table_foreach(before, ungrab_missing_key, after);
+        g_hash_table_foreach(after, grab_missing_key, before);
+        g_hash_table_destroy(after);
+        g_hash_table_destroy(before);
+    }
+    else
+        /* leave the chain, which grabs the keys again from the top */
+        set_curpos(NULL);
 }
 
 void keyboard_startup(gboolean reconfig)
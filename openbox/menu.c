@@ -36,13 +36,38 @@
 #include "gettext.h"
 #include "obt/xml.h"
 #include "obt/paths.h"
+#include "obt/signal.h"
+
+#include <signal.h>
+#include <sys/types.h>
 
 typedef struct _ObMenuParseState ObMenuParseState;
+typedef struct _ObMenuPipe ObMenuPipe;
 
 struct _ObMenuParseState
 {
     ObMenu *parent;
     ObMenu *pipe_creator;
+    ObtXmlInst *inst;
+};
+
+/*! A pipe-menu's command which is running */
+struct _ObMenuPipe
+{
+    ObMenu *menu;
+    /*! The command's process, or 0 once it has been reaped and the pid
+      belongs to it no longer */
+    GPid pid;
+    GIOChannel *chan;
+    guint read_id;
+    guint timeout_id;
+    /*! The output is parsed with its own instance, since more than one
+      pipe-menu can be running at a time */
+    ObtXmlInst *inst;
+    ObMenuParseState state;
+    gboolean valid;
+    /*! Shown at the end of the menu until the command finishes */
+    ObMenuEntry *loading;
 };
 
 static GHashTable *menu_hash = NULL;
@@ -50,15 +75,30 @@ static ObtXmlInst *menu_parse_inst;
 static ObMenuParseState menu_parse_state;
 static gboolean menu_can_hide = FALSE;
 static guint menu_timeout_id = 0;
+/*! The ObMenuPipe of each pipe-menu command which is running */
+static GSList *menu_pipes = NULL;
 
 static void menu_destroy_hash_value(ObMenu *self);
 static void parse_menu_item(xmlNodePtr node, gpointer data);
 static void parse_menu_separator(xmlNodePtr node, gpointer data);
 static void parse_menu(xmlNodePtr node, gpointer data);
+static void pipe_cancel(ObMenuPipe *p);
 static gunichar parse_shortcut(const gchar *label, gboolean allow_shortcut,
                                gchar **strippedlabel, guint *position,
                                gboolean *always_show);
 
+static ObtXmlInst* parse_inst_new(ObMenuParseState *state)
+{
+    ObtXmlInst *i;
+
+    i = obt_xml_instance_new();
+    obt_xml_register(i, "menu", parse_menu, state);
+    obt_xml_register(i, "item", parse_menu_item, state);
+    obt_xml_register(i, "separator", parse_menu_separator, state);
+    state->inst = i;
+    return i;
+}
+
 void menu_startup(gboolean reconfig)
 {
     gboolean loaded = FALSE;
@@ -71,15 +111,9 @@ void menu_startup(gboolean reconfig)
     client_list_combined_menu_startup(reconfig);
     client_menu_startup();
 
-    menu_parse_inst = obt_xml_instance_new();
-
+    menu_parse_inst = parse_inst_new(&menu_parse_state);
     menu_parse_state.parent = NULL;
     menu_parse_state.pipe_creator = NULL;
-    obt_xml_register(menu_parse_inst, "menu", parse_menu, &menu_parse_state);
-    obt_xml_register(menu_parse_inst, "item", parse_menu_item,
-                     &menu_parse_state);
-    obt_xml_register(menu_parse_inst, "separator",
-                       parse_menu_separator, &menu_parse_state);
 
     for (it = config_menu_files; it; it = g_slist_next(it)) {
         if (obt_xml_load_config_file(menu_parse_inst,
@@ -133,56 +167,279 @@ void menu_shutdown(gboolean reconfig)
     menu_hash = NULL;
 }
 
-static gboolean menu_pipe_submenu(gpointer key, gpointer val, gpointer data)
+void menu_reload(void)
+{
+    ob_debug("Reloading the menus");
+    menu_shutdown(TRUE);
+    menu_startup(TRUE);
+}
+
+static glong pipe_now(void)
+{
+    GTimeVal now;
+
+    g_get_current_time(&now);
+    return now.tv_sec;
+}
+
+static void find_pipe_children(gpointer key, gpointer val, gpointer data)
+{
+    ObMenu *menu = val;
+    gpointer *d = data;
+
+    if (menu->pipe_creator == d[0])
+        d[1] = g_slist_prepend(d[1], g_strdup(menu->name));
+}
+
+/*! Destroy the menus which were made by the pipe-menu's command */
+static void destroy_pipe_children(ObMenu *self)
+{
+    gpointer d[2];
+    GSList *names;
+
+    d[0] = self;
+    d[1] = NULL;
+    g_hash_table_foreach(menu_hash, find_pipe_children, d);
+
+    /* the names are looked up again, since destroying one can destroy
+       another one in the list */
+    for (names = d[1]; names; names = g_slist_delete_link(names, names)) {
+        ObMenu *menu = g_hash_table_lookup(menu_hash, names->data);
+        if (menu) {
+            destroy_pipe_children(menu);
+            menu_free(menu);
+        }
+        g_free(names->data);
+    }
+}
+
+void menu_clear_pipe_cache(ObMenu *self)
+{
+    if (self->pipe) pipe_cancel(self->pipe);
+    destroy_pipe_children(self);
+    menu_clear_entries(self);
+    self->execute_time = 0;
+    self->execute_expired = FALSE;
+}
+
+static void find_pipe_menus(gpointer key, gpointer val, gpointer data)
 {
     ObMenu *menu = val;
-    return menu->pipe_creator != NULL;
+    gpointer *d = data;
+    glong now = *(glong*)d[0];
+
+    if (menu->execute && (menu->execute_time || menu->pipe) &&
+        (!d[1] || menu->execute_expired ||
+         now - menu->execute_time >= menu->execute_cache_time))
+        d[2] = g_slist_prepend(d[2], g_strdup(menu->name));
 }
 
-static void clear_cache(gpointer key, gpointer val, gpointer data)
+/*! Clear the pipe-menus, all of them, or only the ones which have been kept
+  longer than their cache time or were expired */
+static void clear_pipe_caches(gboolean expired)
+{
+    glong now = pipe_now();
+    gpointer d[3];
+    GSList *names;
+
+    d[0] = &now;
+    d[1] = GINT_TO_POINTER(expired);
+    d[2] = NULL;
+    g_hash_table_foreach(menu_hash, find_pipe_menus, d);
+
+    for (names = d[2]; names; names = g_slist_delete_link(names, names)) {
+        ObMenu *menu = g_hash_table_lookup(menu_hash, names->data);
+        if (menu) menu_clear_pipe_cache(menu);
+        g_free(names->data);
+    }
+}
+
+static void expire_pipe_cache(gpointer key, gpointer val, gpointer data)
 {
     ObMenu *menu = val;
-    if (menu->execute)
-        menu_clear_entries(menu);
+
+    if (menu->execute && (menu->execute_time || menu->pipe))
+        menu->execute_expired = TRUE;
+}
+
+void menu_expire_pipe_caches(void)
+{
+    /* they can't be changed while they are visible, so they are cleared when
+       the next menu is shown */
+    g_hash_table_foreach(menu_hash, expire_pipe_cache, NULL);
+}
+
+static void pipe_free(ObMenuPipe *p)
+{
+    if (p->read_id) g_source_remove(p->read_id);
+    if (p->timeout_id) g_source_remove(p->timeout_id);
+    g_io_channel_unref(p->chan);
+    if (p->loading) menu_entry_remove(p->loading);
+    p->menu->pipe = NULL;
+    menu_pipes = g_slist_remove(menu_pipes, p);
+    g_slice_free(ObMenuPipe, p);
 }
 
-void menu_clear_pipe_caches(void)
+static void pipe_add_loading(ObMenuPipe *p)
 {
-    /* delete any pipe menus' submenus */
-    g_hash_table_foreach_remove(menu_hash, menu_pipe_submenu, NULL);
-    /* empty the top level pipe menus */
-    g_hash_table_foreach(menu_hash, clear_cache, NULL);
+    p->loading = menu_add_normal(p->menu, -1, _("Loading..."), NULL, FALSE);
+    p->loading->data.normal.enabled = FALSE;
+}
+
+/*! Parse the command's output which is ready to be read */
+static void pipe_read_output(ObMenuPipe *p, gboolean *eof)
+{
+    gchar buf[4096];
+    gsize n;
+    GIOStatus st;
+    GList *loading;
+
+    /* keep the loading entry at the end of the menu, after the new ones.  it
+       is moved rather than made again, so its frame can stay */
+    loading = g_list_find(p->menu->entries, p->loading);
+    p->menu->entries = g_list_remove_link(p->menu->entries, loading);
+
+    do {
+        st = g_io_channel_read_chars(p->chan, buf, sizeof(buf), &n, NULL);
+        if (n && p->valid)
+            p->valid = obt_xml_stream_feed(p->inst, buf, n);
+    } while (st == G_IO_STATUS_NORMAL && n == sizeof(buf));
+
+    p->menu->entries = g_list_concat(p->menu->entries, loading);
+
+    *eof = st == G_IO_STATUS_EOF || st == G_IO_STATUS_ERROR;
+}
+
+static void pipe_finish(ObMenuPipe *p, gboolean timed_out)
+{
+    ObMenu *menu = p->menu;
+
+    if (timed_out) {
+        if (p->pid) kill(p->pid, SIGTERM);
+        g_message(_("The command for pipe-menu \"%s\" took too long and "
+                    "was stopped"), menu->execute);
+    }
+
+    if (p->loading) {
+        menu_entry_remove(p->loading);
+        p->loading = NULL;
+    }
+    if (!obt_xml_stream_end(p->inst) && !timed_out)
+        g_message(_("Invalid output from pipe-menu \"%s\""), menu->execute);
+    obt_xml_instance_unref(p->inst);
+
+    menu->execute_time = pipe_now();
+    pipe_free(p);
+
+    menu_frame_refresh(menu);
+}
+
+/*! Stop the command without using anything more from it */
+static void pipe_cancel(ObMenuPipe *p)
+{
+    if (p->pid) kill(p->pid, SIGTERM);
+    /* the parser may still have a complete entry to give */
+    obt_xml_unregister(p->inst, "menu");
+    obt_xml_unregister(p->inst, "item");
+    obt_xml_unregister(p->inst, "separator");
+    obt_xml_stream_end(p->inst);
+    obt_xml_instance_unref(p->inst);
+    pipe_free(p);
+}
+
+static gboolean pipe_read(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    ObMenuPipe *p = data;
+    gboolean eof = TRUE;
+
+    if (cond & G_IO_IN)
+        pipe_read_output(p, &eof);
+
+    if (eof) {
+        p->read_id = 0;
+        pipe_finish(p, FALSE);
+        return FALSE; /* stop watching */
+    }
+    menu_frame_refresh(p->menu);
+    return TRUE;
+}
+
+static gboolean pipe_timeout(gpointer data)
+{
+    ObMenuPipe *p = data;
+
+    p->timeout_id = 0;
+    pipe_finish(p, TRUE);
+    return FALSE; /* don't repeat */
 }
 
 void menu_pipe_execute(ObMenu *self)
 {
-    gchar *output;
+    ObMenuPipe *p;
+    gchar **argv;
+    GPid pid;
+    gint out;
     GError *err = NULL;
 
     if (!self->execute)
         return;
-    if (self->entries) /* the entries are already created and cached */
-        return;
-
-    if (!g_spawn_command_line_sync(self->execute, &output, NULL, NULL, &err)) {
+    if (self->pipe || self->execute_time)
+        return; /* the command is running or its entries are cached */
+
+    /* the child is not reaped by glib, so its pid stays ours to kill until
+       menu_pipe_reaped() says otherwise */
+    if (!g_shell_parse_argv(self->execute, NULL, &argv, &err) ||
+        !g_spawn_async_with_pipes(NULL, argv, NULL,
+                                  G_SPAWN_SEARCH_PATH |
+                                  G_SPAWN_DO_NOT_REAP_CHILD,
+                                  obt_signal_child_setup, NULL, &pid,
+                                  NULL, &out, NULL, &err))
+    {
         g_message(_("Failed to execute command for pipe-menu \"%s\": %s"),
                   self->execute, err->message);
         g_error_free(err);
+        g_strfreev(argv);
         return;
     }
+    g_strfreev(argv);
+
+    p = g_slice_new0(ObMenuPipe);
+    p->menu = self;
+    p->pid = pid;
+    self->pipe = p;
+    menu_pipes = g_slist_prepend(menu_pipes, p);
+
+    p->chan = g_io_channel_unix_new(out);
+    g_io_channel_set_close_on_unref(p->chan, TRUE);
+    g_io_channel_set_encoding(p->chan, NULL, NULL);
+    g_io_channel_set_flags(p->chan, G_IO_FLAG_NONBLOCK, NULL);
+    p->read_id = g_io_add_watch(p->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                pipe_read, p);
+    if (self->execute_timeout)
+        p->timeout_id = g_timeout_add(self->execute_timeout, pipe_timeout, p);
+
+    /* the entries are added as each one is parsed */
+    p->inst = parse_inst_new(&p->state);
+    p->state.pipe_creator = self;
+    p->state.parent = self;
+    p->valid = TRUE;
+    obt_xml_stream_begin(p->inst, "openbox_pipe_menu");
+
+    pipe_add_loading(p);
+}
 
-    if (obt_xml_load_mem(menu_parse_inst, output, strlen(output),
-                         "openbox_pipe_menu"))
-    {
-        menu_parse_state.pipe_creator = self;
-        menu_parse_state.parent = self;
-        obt_xml_tree_from_root(menu_parse_inst);
-        obt_xml_close(menu_parse_inst);
-    } else {
-        g_message(_("Invalid output from pipe-menu \"%s\""), self->execute);
-    }
+void menu_pipe_reaped(GPid pid)
+{
+    GSList *it;
 
-    g_free(output);
+    for (it = menu_pipes; it; it = g_slist_next(it)) {
+        ObMenuPipe *p = it->data;
+        if (p->pid == pid) {
+            g_spawn_close_pid(p->pid);
+            p->pid = 0;
+            break;
+        }
+    }
 }
 
 static ObMenu* menu_from_name(gchar *name)
@@ -349,13 +606,21 @@ static void parse_menu(xmlNodePtr node, gpointer data)
         if ((menu = menu_new(name, title, TRUE, NULL))) {
             menu->pipe_creator = state->pipe_creator;
             if (obt_xml_attr_string(node, "execute", &script)) {
+                gint i;
+
                 menu->execute = obt_paths_expand_tilde(script);
+                menu->execute_timeout = config_menu_pipe_timeout;
+                menu->execute_cache_time = config_menu_pipe_cache_time;
+                if (obt_xml_attr_int(node, "timeout", &i))
+                    menu->execute_timeout = MAX(0, i);
+                if (obt_xml_attr_int(node, "cacheTime", &i))
+                    menu->execute_cache_time = MAX(0, i);
             } else {
                 ObMenu *old;
 
                 old = state->parent;
                 state->parent = menu;
-                obt_xml_tree(menu_parse_inst, node->children);
+                obt_xml_tree(state->inst, node->children);
                 state->parent = old;
             }
         }
@@ -434,6 +699,7 @@ static void menu_destroy_hash_value(ObMenu *self)
     if (self->destroy_func)
         self->destroy_func(self, self->data);
 
+    if (self->pipe) pipe_cancel(self->pipe);
     menu_clear_entries(self);
     g_free(self->name);
     g_free(self->title);
@@ -477,8 +743,9 @@ void menu_show(gchar *name, const GravityPoint *pos, gint monitor,
 
     menu_frame_hide_all();
 
-    /* clear the pipe menus when showing a new menu */
-    menu_clear_pipe_caches();
+    /* clear the pipe menus which have been kept long enough, when showing
+       a new menu */
+    clear_pipe_caches(TRUE);
 
     frame = menu_frame_new(self, 0, client);
     if (!menu_frame_show_topmenu(frame, pos, monitor, mouse, user_positioned))
@@ -607,6 +874,7 @@ void menu_clear_entries(ObMenu *self)
 void menu_entry_remove(ObMenuEntry *self)
 {
     self->menu->entries = g_list_remove(self->menu->entries, self);
+    self->menu->more_menu->entries = self->menu->entries; /* keep in sync */
     menu_entry_unref(self);
 }
 
@@ -74,6 +74,17 @@ struct _ObMenu
 
     /* Command to execute to rebuild the menu */
     gchar *execute;
+    /*! How long the command may run, in milliseconds, 0 for no limit */
+    guint execute_timeout;
+    /*! How long the entries made by the command are kept, in seconds */
+    guint execute_cache_time;
+    /*! When the entries were made by the command, 0 if they have not been */
+    glong execute_time;
+    /*! The entries are cleared the next time a menu is shown, even if they
+      have not been kept for execute_cache_time */
+    gboolean execute_expired;
+    /*! The command while it is running */
+    struct _ObMenuPipe *pipe;
 
     /* ObMenuEntry list */
     GList *entries;
@@ -167,6 +178,9 @@ struct _ObMenuEntry
 void menu_startup(gboolean reconfig);
 void menu_shutdown(gboolean reconfig);
 
+/*! Load the menu files again, without reconfiguring anything else */
+void menu_reload(void);
+
 void menu_entry_ref(ObMenuEntry *self);
 void menu_entry_unref(ObMenuEntry *self);
 
@@ -174,10 +188,17 @@ ObMenu* menu_new(const gchar *name, const gchar *title,
                  gboolean allow_shortcut_selection, gpointer data);
 void menu_free(ObMenu *menu);
 
-/*! Repopulate a pipe-menu by running its command */
+/*! Repopulate a pipe-menu by running its command.  The command runs in the
+  background, and its entries are added to the menu as they are read. */
 void menu_pipe_execute(ObMenu *self);
-/*! Clear a pipe-menu's entries */
-void menu_clear_pipe_caches(void);
+/*! Forget a pipe-menu command's process once it has been reaped, so it is not
+  signalled after its pid could be used again */
+void menu_pipe_reaped(GPid pid);
+/*! Clear a pipe-menu's entries, and destroy the menus it created */
+void menu_clear_pipe_cache(ObMenu *self);
+/*! Make all the pipe-menus run their commands again the next time a menu is
+  shown, without changing the ones which are visible now */
+void menu_expire_pipe_caches(void);
 
 void menu_show_all_shortcuts(ObMenu *self, gboolean show);
 
@@ -952,6 +952,76 @@ static void menu_frame_update(ObMenuFrame *self)
     menu_frame_render(self);
 }
 
+void menu_frame_refresh(ObMenu *menu)
+{
+    GList *it, *mit, *eit;
+
+    for (it = menu_frame_visible; it; it = g_list_next(it)) {
+        ObMenuFrame *f = it->data;
+        ObMenuEntry *selected, *opened;
+        GList *old;
+        gint dx, dy;
+
+        if (f->menu != menu) continue;
+
+        /* hold onto the selected entry, and the one a submenu is open from,
+           so they can be found again among the frame's entries */
+        selected = f->selected ? f->selected->entry : NULL;
+        if (selected) menu_entry_ref(selected);
+        opened = f->child ? f->child->parent_entry->entry : NULL;
+        if (opened) menu_entry_ref(opened);
+
+        /* keep the frames of the entries which are still in the menu, and
+           only make new ones for the entries which were added */
+        old = f->entries;
+        f->entries = NULL;
+        for (mit = g_list_nth(menu->entries, f->show_from); mit;
+             mit = g_list_next(mit))
+        {
+            ObMenuEntryFrame *e = NULL;
+
+            for (eit = old; eit; eit = g_list_next(eit))
+                if (((ObMenuEntryFrame*)eit->data)->entry == mit->data) {
+                    e = eit->data;
+                    old = g_list_delete_link(old, eit);
+                    break;
+                }
+            if (!e) e = menu_entry_frame_new(mit->data, f);
+            f->entries = g_list_append(f->entries, e);
+        }
+        while (old) {
+            menu_entry_frame_free(old->data);
+            old = g_list_delete_link(old, old);
+        }
+
+        menu_frame_update(f);
+
+        /* keep the same entry selected */
+        for (eit = f->entries; selected && eit; eit = g_list_next(eit)) {
+            ObMenuEntryFrame *e = eit->data;
+            if (e->entry == selected) {
+                f->selected = e;
+                menu_entry_frame_render(e);
+                break;
+            }
+        }
+        if (selected) menu_entry_unref(selected);
+
+        /* a submenu stays open unless its entry is gone.  it was shown after
+           us, so it is earlier in the list, behind the iterator */
+        for (eit = f->entries; opened && eit; eit = g_list_next(eit))
+            if (((ObMenuEntryFrame*)eit->data)->entry == opened)
+                break;
+        if (opened && !eit)
+            menu_frame_hide(f->child);
+        if (opened) menu_entry_unref(opened);
+
+        /* it may have grown past the edge of the screen */
+        menu_frame_move_on_screen(f, f->area.x, f->area.y, &dx, &dy);
+        menu_frame_move(f, f->area.x + dx, f->area.y + dy);
+    }
+}
+
 static gboolean menu_frame_is_visible(ObMenuFrame *self)
 {
     return !!(g_list_find(menu_frame_visible, self));
@@ -130,6 +130,8 @@ void menu_frame_hide_all(void);
 void menu_frame_hide_all_client(struct _ObClient *client);
 
 void menu_frame_render(ObMenuFrame *self);
+/*! Show the changes to a menu's entries in the frames where it is visible */
+void menu_frame_refresh(struct _ObMenu *menu);
 
 void menu_frame_select(ObMenuFrame *self, ObMenuEntryFrame *entry,
                        gboolean immediate);
@@ -603,6 +603,7 @@ static void edge_warp_move_ptr(void)
     }
 
     XWarpPointer(obt_display, 0, obt_root(ob_screen), 0, 0, 0, 0, x, y);
+    screen_pointer_forget();
 }
 
 static gboolean edge_warp_delay_func(gpointer data)
@@ -719,7 +720,8 @@ static void move_with_keys(KeySym sym, guint state)
 
     screen_pointer_pos(&opx, &opy);
     XWarpPointer(obt_display, None, None, 0, 0, 0, 0, dx, dy);
-    /* steal the motion events this causes */
+    /* steal the motion events this causes, so ask where it went */
+    screen_pointer_forget();
     XSync(obt_display, FALSE);
     {
         XEvent ce;
@@ -911,7 +913,8 @@ static void resize_with_keys(KeySym sym, guint state)
 
     screen_pointer_pos(&opx, &opy);
     XWarpPointer(obt_display, None, None, 0, 0, 0, 0, pdx, pdy);
-    /* steal the motion events this causes */
+    /* steal the motion events this causes, so ask where it went */
+    screen_pointer_forget();
     XSync(obt_display, FALSE);
     {
         XEvent ce;
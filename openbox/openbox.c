@@ -27,6 +27,7 @@
 #include "screen.h"
 #include "actions.h"
 #include "startupnotify.h"
+#include "ipc.h"
 #include "focus.h"
 #include "focus_cycle.h"
 #include "focus_cycle_indicator.h"
@@ -42,6 +43,9 @@
 #include "config.h"
 #include "ping.h"
 #include "prompt.h"
+#include "publish.h"
+#include "spatial.h"
+#include "autoreload.h"
 #include "gettext.h"
 #include "obrender/render.h"
 #include "obrender/theme.h"
@@ -328,6 +332,8 @@ gint main(gint argc, gchar **argv)
             menu_frame_startup(reconfigure);
             menu_startup(reconfigure);
             prompt_startup(reconfigure);
+            autoreload_startup(reconfigure);
+            ipc_startup(reconfigure);
 
             if (!reconfigure) {
                 /* do this after everything is started so no events will get
@@ -391,6 +397,11 @@ gint main(gint argc, gchar **argv)
             if (!reconfigure)
                 window_unmanage_all();
 
+            /* write out the root properties before shutting things down */
+            publish_flush();
+
+            ipc_shutdown(reconfigure);
+            autoreload_shutdown(reconfigure);
             prompt_shutdown(reconfigure);
             menu_shutdown(reconfigure);
             menu_frame_shutdown(reconfigure);
@@ -399,6 +410,7 @@ gint main(gint argc, gchar **argv)
             moveresize_shutdown(reconfigure);
             dock_shutdown(reconfigure);
             client_shutdown(reconfigure);
+            spatial_shutdown(reconfigure);
             ping_shutdown(reconfigure);
             group_shutdown(reconfigure);
             grab_shutdown(reconfigure);
@@ -412,6 +424,7 @@ gint main(gint argc, gchar **argv)
             event_shutdown(reconfigure);
             config_shutdown();
             actions_shutdown(reconfigure);
+            publish_shutdown(reconfigure);
         } while (reconfigure);
     }
 
@@ -423,6 +436,12 @@ gint main(gint argc, gchar **argv)
 
     session_shutdown(being_replaced);
 
+    {
+        guint hits, misses;
+        obt_prop_cache_stats(&hits, &misses);
+        ob_debug("Property cache: %u hits, %u misses", hits, misses);
+    }
+
     obt_display_close();
 
     if (restart) {
@@ -491,6 +510,8 @@ gint main(gint argc, gchar **argv)
 
 static void signal_handler(gint signal, gpointer data)
 {
+    pid_t pid;
+
     switch (signal) {
     case SIGUSR1:
         ob_debug("Caught signal %d. Restarting.", signal);
@@ -502,7 +523,8 @@ static void signal_handler(gint signal, gpointer data)
         break;
     case SIGCHLD:
         /* reap children */
-        while (waitpid(-1, NULL, WNOHANG) > 0);
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+            menu_pipe_reaped(pid);
         break;
     case SIGTTIN:
     case SIGTTOU:
@@ -549,7 +571,9 @@ static void print_help(void)
     g_print(_("  --debug             Display debugging output\n"));
     g_print(_("  --debug-focus       Display debugging output for focus handling\n"));
     g_print(_("  --debug-session     Display debugging output for session management\n"));
+    g_print(_("  --debug-latency     Display how long desktop switches take\n"));
     g_print(_("  --debug-xinerama    Split the display into fake xinerama screens\n"));
+    g_print(_("  --debug-prop-cache  Check cached window properties against the server\n"));
     g_print(_("\nPlease report bugs at %s\n"), PACKAGE_BUGREPORT);
 }
 
@@ -579,7 +603,7 @@ static void run_startup_cmd(void)
     ok = g_spawn_async(NULL, argv, NULL,
                        G_SPAWN_SEARCH_PATH |
                        G_SPAWN_DO_NOT_REAP_CHILD,
-                       NULL, NULL, NULL, &e);
+                       obt_signal_child_setup, NULL, NULL, &e);
     if (!ok) {
         g_message("Error launching startup command: %s",
                   e->message);
@@ -653,9 +677,15 @@ static void parse_args(gint *argc, gchar **argv)
         else if (!strcmp(argv[i], "--debug-session")) {
             ob_debug_enable(OB_DEBUG_SM, TRUE);
         }
+        else if (!strcmp(argv[i], "--debug-latency")) {
+            ob_debug_enable(OB_DEBUG_LATENCY, TRUE);
+        }
         else if (!strcmp(argv[i], "--debug-xinerama")) {
             ob_debug_xinerama = TRUE;
         }
+        else if (!strcmp(argv[i], "--debug-prop-cache")) {
+            obt_prop_cache_set_verify(TRUE);
+        }
         else if (!strcmp(argv[i], "--reconfigure")) {
             remote_control = 1;
         }
@@ -753,6 +783,11 @@ void ob_reconfigure(void)
     ob_exit(0);
 }
 
+const gchar* ob_config_file(void)
+{
+    return config_file;
+}
+
 void ob_exit(gint code)
 {
     exitcode = code;
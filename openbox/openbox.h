@@ -59,6 +59,10 @@ void ob_exit_replace(void);
 
 void ob_reconfigure(void);
 
+/*! The config file given on the command line, or NULL if the config file is
+  found in the XDG config directories */
+const gchar* ob_config_file(void);
+
 void ob_exit_with_error(const gchar *msg) G_GNUC_NORETURN;
 
 Cursor ob_cursor(ObCursor cursor);
@@ -26,6 +26,7 @@
 #include "dock.h"
 #include "debug.h"
 #include "place_overlap.h"
+#include "spatial.h"
 
 static Rect *choose_pointer_monitor(ObClient *c)
 {
@@ -402,8 +403,12 @@ static gboolean place_least_overlap(ObClient *c, Rect *head, int *x, int *y,
     }
 
     if (!ignore_windows) {
-        GList* it;
-        for (it = client_list; it != NULL; it = g_list_next(it)) {
+        GSList *it, *found;
+
+        /* windows outside of the head can't overlap with the placement */
+        found = spatial_find_rect(head, (c->desktop != DESKTOP_ALL ?
+                                         c->desktop : screen_desktop), TRUE);
+        for (it = found; it != NULL; it = g_slist_next(it)) {
             ObClient* maybe_client = (ObClient*)it->data;
             if (maybe_client == c)
                 continue;
@@ -411,24 +416,16 @@ static gboolean place_least_overlap(ObClient *c, Rect *head, int *x, int *y,
                 continue;
             if (!client_occupies_space(maybe_client))
                 continue;
-            if (c->desktop != DESKTOP_ALL) {
-                if (maybe_client->desktop != c->desktop &&
-                    maybe_client->desktop != DESKTOP_ALL)
-                    continue;
-            } else {
-                if (maybe_client->desktop != screen_desktop &&
-                    maybe_client->desktop != DESKTOP_ALL)
-                    continue;
-            }
 
             potential_overlap_clients = g_slist_prepend(
                 potential_overlap_clients, maybe_client);
             n_client_rects += 1;
         }
+        g_slist_free(found);
     }
 
     if (n_client_rects) {
-        Rect client_rects[n_client_rects];
+        Rect *client_rects = g_new(Rect, n_client_rects);
         GSList* it;
         Point result;
         guint i = 0;
@@ -443,7 +440,9 @@ static gboolean place_least_overlap(ObClient *c, Rect *head, int *x, int *y,
         g_slist_free(potential_overlap_clients);
 
         place_overlap_find_least_placement(client_rects, n_client_rects, head,
-                                           &frame_size, &result);
+                                           &frame_size, config_place_center,
+                                           &result);
+        g_free(client_rects);
         *x = result.x;
         *y = result.y;
     }
@@ -16,7 +16,6 @@
    See the COPYING file for a copy of the GNU General Public License.
 */
 
-#include "config.h"
 #include "geom.h"
 #include "place_overlap.h"
 #include "obt/bsearch.h"
@@ -24,6 +23,34 @@
 #include <glib.h>
 #include <stdlib.h>
 
+/* The area of the client rects covered by a rectangle is found with a
+   coverage map of the rows of the grid, one row at a time.  The client rects
+   are clipped to the monitor, and their left and right edges split the row
+   into columns.  For each column the map has the total height of the client
+   rects in it, and the area of the client rects left of it.  Then the area
+   covered by a rectangle in the row is found with two binary searches,
+   instead of looking at every client rect.  Everything is on the heap, so
+   the number of client rects is not limited by the stack size. */
+
+typedef struct _OverlapMap {
+    /* The client rects clipped to the monitor */
+    Rect* rects;
+    int n_rects;
+    /* The first and one past the last column of each clipped rect */
+    int* rect_cols;
+    /* The sorted x positions where the columns start */
+    int* cols;
+    int n_cols;
+} OverlapMap;
+
+/* The coverage of one row of the map */
+typedef struct _OverlapRow {
+    /* The total height of the client rects in each column */
+    gint64* height;
+    /* The area of the client rects left of each column */
+    gint64* area_before;
+} OverlapRow;
+
 static void make_grid(const Rect* client_rects,
                       int n_client_rects,
                       const Rect* monitor,
@@ -31,12 +58,22 @@ static void make_grid(const Rect* client_rects,
                       int* y_edges,
                       int max_edges);
 
-static int best_direction(const Point* grid_point,
-                          const Rect* client_rects,
-                          int n_client_rects,
-                          const Rect* monitor,
-                          const Size* req_size,
-                          Point* best_top_left);
+static void overlap_map_init(OverlapMap* map,
+                             const Rect* client_rects,
+                             int n_client_rects,
+                             const Rect* monitor);
+
+static void overlap_map_clear(OverlapMap* map);
+
+static void overlap_row_fill(OverlapRow* row,
+                             const OverlapMap* map,
+                             int top,
+                             int height);
+
+static gint64 overlap_row_area(const OverlapRow* row,
+                               const OverlapMap* map,
+                               int left,
+                               int width);
 
 static int total_overlap(const Rect* client_rects,
                          int n_client_rects,
@@ -51,46 +88,97 @@ static void center_in_field(Point* grid_point,
                             const int* y_edges,
                             int max_edges);
 
-/* Choose the placement on a grid with least overlap */
+/* Choose the placement on a grid with least overlap.
+
+   From each grid point, a rectangle can be placed down and right, up and
+   right, down and left or up and left of it.  The first of these, in that
+   order, with the least overlap is chosen, walking the grid points a column
+   at a time.  The coverage map is made for a row at a time though, so to
+   pick the same placement, a later placement with equal overlap replaces the
+   best one only when it is in an earlier column. */
+
+#define NUM_DIRECTIONS 4
 
 void place_overlap_find_least_placement(const Rect* client_rects,
                                         int n_client_rects,
                                         const Rect *monitor,
                                         const Size* req_size,
+                                        gboolean center,
                                         Point* result)
 {
+    static const Size directions[NUM_DIRECTIONS] = {
+        {0, 0}, {0, -1}, {-1, 0}, {-1, -1}
+    };
     POINT_SET(*result, monitor->x, monitor->y);
-    int overlap = G_MAXINT;
+    gint64 overlap = G_MAXINT64;
+    int best_column = G_MAXINT;
     int max_edges = 2 * (n_client_rects + 1);
 
-    int x_edges[max_edges];
-    int y_edges[max_edges];
+    int* x_edges = g_new(int, max_edges);
+    int* y_edges = g_new(int, max_edges);
     make_grid(client_rects, n_client_rects, monitor,
             x_edges, y_edges, max_edges);
-    int i;
-    for (i = 0; i < max_edges; ++i) {
-        if (x_edges[i] == G_MAXINT)
+
+    OverlapMap map;
+    overlap_map_init(&map, client_rects, n_client_rects, monitor);
+    /* the rows below and above the grid points */
+    OverlapRow rows[2];
+    int k;
+    for (k = 0; k < 2; ++k) {
+        rows[k].height = g_new(gint64, map.n_cols);
+        rows[k].area_before = g_new(gint64, map.n_cols);
+    }
+
+    int j;
+    for (j = 0; j < max_edges; ++j) {
+        if (y_edges[j] == G_MAXINT)
+            break;
+        /* nothing later can be better than no overlap in the first column */
+        if (overlap == 0 && best_column == 0)
             break;
-        int j;
-        for (j = 0; j < max_edges; ++j) {
-            if (y_edges[j] == G_MAXINT)
+        overlap_row_fill(&rows[0], &map, y_edges[j], req_size->height);
+        overlap_row_fill(&rows[1], &map, y_edges[j] - req_size->height,
+                         req_size->height);
+        int i;
+        for (i = 0; i < max_edges; ++i) {
+            if (x_edges[i] == G_MAXINT)
                 break;
-            Point grid_point = {.x = x_edges[i], .y = y_edges[j]};
-            Point best_top_left;
-            int this_overlap =
-                best_direction(&grid_point, client_rects, n_client_rects,
-                        monitor, req_size, &best_top_left);
-            if (this_overlap < overlap) {
-                overlap = this_overlap;
-                *result = best_top_left;
-            }
-            if (overlap == 0)
+            /* only an earlier column can replace no overlap */
+            if (overlap == 0 && i >= best_column)
                 break;
+            int d;
+            for (d = 0; d < NUM_DIRECTIONS; ++d) {
+                Point pt = {
+                    .x = x_edges[i] + (req_size->width * directions[d].width),
+                    .y = y_edges[j] + (req_size->height * directions[d].height)
+                };
+                Rect r;
+                RECT_SET(r, pt.x, pt.y, req_size->width, req_size->height);
+                if (!RECT_CONTAINS_RECT(*monitor, r))
+                    continue;
+                gint64 this_overlap =
+                    overlap_row_area(&rows[directions[d].height ? 1 : 0],
+                                     &map, pt.x, req_size->width);
+                if (this_overlap < overlap ||
+                    (this_overlap == overlap && i < best_column))
+                {
+                    overlap = this_overlap;
+                    best_column = i;
+                    *result = pt;
+                }
+                if (overlap == 0 && best_column == i)
+                    break;
+            }
         }
-        if (overlap == 0)
-            break;
     }
-    if (config_place_center && overlap == 0) {
+
+    for (k = 0; k < 2; ++k) {
+        g_free(rows[k].height);
+        g_free(rows[k].area_before);
+    }
+    overlap_map_clear(&map);
+
+    if (center && overlap == 0) {
         center_in_field(result,
                         req_size,
                         monitor,
@@ -100,6 +188,8 @@ void place_overlap_find_least_placement(const Rect* client_rects,
                         y_edges,
                         max_edges);
     }
+    g_free(x_edges);
+    g_free(y_edges);
 }
 
 static int compare_ints(const void* a,
@@ -156,6 +246,113 @@ static void make_grid(const Rect* client_rects,
     uniquify(y_edges, n_edges);
 }
 
+static int find_column(int x,
+                       const int* cols,
+                       int n_cols)
+{
+    BSEARCH_SETUP();
+    BSEARCH(int, cols, 0, n_cols, x);
+
+    if (BSEARCH_FOUND())
+        return BSEARCH_AT();
+
+    g_assert(BSEARCH_FOUND_NEAREST_SMALLER());
+    return BSEARCH_AT();
+}
+
+static void overlap_map_init(OverlapMap* map,
+                             const Rect* client_rects,
+                             int n_client_rects,
+                             const Rect* monitor)
+{
+    int i;
+    int n_edges = 0;
+
+    map->rects = g_new(Rect, n_client_rects);
+    map->rect_cols = g_new(int, 2 * n_client_rects);
+    map->cols = g_new(int, 2 * (n_client_rects + 1));
+    map->n_rects = 0;
+    for (i = 0; i < n_client_rects; ++i) {
+        if (!RECT_INTERSECTS_RECT(client_rects[i], *monitor))
+            continue;
+        Rect* r = &map->rects[map->n_rects++];
+        RECT_SET_INTERSECTION(*r, client_rects[i], *monitor);
+        map->cols[n_edges++] = r->x;
+        map->cols[n_edges++] = r->x + r->width;
+    }
+    map->cols[n_edges++] = monitor->x;
+    map->cols[n_edges++] = monitor->x + monitor->width;
+    qsort(map->cols, n_edges, sizeof(int), compare_ints);
+    uniquify(map->cols, n_edges);
+    for (map->n_cols = 0; map->n_cols < n_edges; ++map->n_cols)
+        if (map->cols[map->n_cols] == G_MAXINT)
+            break;
+
+    for (i = 0; i < map->n_rects; ++i) {
+        const Rect* r = &map->rects[i];
+        map->rect_cols[2 * i] = find_column(r->x, map->cols, map->n_cols);
+        map->rect_cols[2 * i + 1] =
+            find_column(r->x + r->width, map->cols, map->n_cols);
+    }
+}
+
+static void overlap_map_clear(OverlapMap* map)
+{
+    g_free(map->rects);
+    g_free(map->rect_cols);
+    g_free(map->cols);
+}
+
+static void overlap_row_fill(OverlapRow* row,
+                             const OverlapMap* map,
+                             int top,
+                             int height)
+{
+    int i;
+    for (i = 0; i < map->n_cols; ++i)
+        row->height[i] = 0;
+
+    /* add each rect's height in the row at its first column, and take it
+       away after its last column */
+    for (i = 0; i < map->n_rects; ++i) {
+        const Rect* r = &map->rects[i];
+        int h = MIN(top + height, r->y + r->height) - MAX(top, r->y);
+        if (h <= 0)
+            continue;
+        row->height[map->rect_cols[2 * i]] += h;
+        row->height[map->rect_cols[2 * i + 1]] -= h;
+    }
+
+    gint64 height_sum = 0;
+    gint64 area_sum = 0;
+    for (i = 0; i < map->n_cols; ++i) {
+        height_sum += row->height[i];
+        row->height[i] = height_sum;
+        row->area_before[i] = area_sum;
+        if (i + 1 < map->n_cols)
+            area_sum += height_sum * (map->cols[i + 1] - map->cols[i]);
+    }
+}
+
+/* Returns the area of the client rects in the row left of x, which must be
+   on the monitor */
+static gint64 area_left_of(const OverlapRow* row,
+                           const OverlapMap* map,
+                           int x)
+{
+    int i = find_column(x, map->cols, map->n_cols);
+    return row->area_before[i] + row->height[i] * (x - map->cols[i]);
+}
+
+static gint64 overlap_row_area(const OverlapRow* row,
+                               const OverlapMap* map,
+                               int left,
+                               int width)
+{
+    return area_left_of(row, map, left + width) -
+        area_left_of(row, map, left);
+}
+
 static int total_overlap(const Rect* client_rects,
                          int n_client_rects,
                          const Rect* proposed_rect)
@@ -292,43 +489,3 @@ static void center_in_field(Point* top_left,
     top_left->x += (final_width - req_size->width) / 2;
     top_left->y += (final_height - req_size->height) / 2;
 }
-
-/* Given a list of Rect RECTS, a Point PT and a Size size, determine the
-   direction from PT which results in the least total overlap with RECTS
-   if a rectangle is placed in that direction.  Return the top/left
-   Point of such rectangle and the resulting overlap amount.  Only
-   consider placements within BOUNDS. */
-
-#define NUM_DIRECTIONS 4
-
-static int best_direction(const Point* grid_point,
-                          const Rect* client_rects,
-                          int n_client_rects,
-                          const Rect* monitor,
-                          const Size* req_size,
-                          Point* best_top_left)
-{
-    static const Size directions[NUM_DIRECTIONS] = {
-        {0, 0}, {0, -1}, {-1, 0}, {-1, -1}
-    };
-    int overlap = G_MAXINT;
-    int i;
-    for (i = 0; i < NUM_DIRECTIONS; ++i) {
-        Point pt = {
-            .x = grid_point->x + (req_size->width * directions[i].width),
-            .y = grid_point->y + (req_size->height * directions[i].height)
-        };
-        Rect r;
-        RECT_SET(r, pt.x, pt.y, req_size->width, req_size->height);
-        if (!RECT_CONTAINS_RECT(*monitor, r))
-            continue;
-        int this_overlap = total_overlap(client_rects, n_client_rects, &r);
-        if (this_overlap < overlap) {
-            overlap = this_overlap;
-            *best_top_left = pt;
-        }
-        if (overlap == 0)
-            break;
-    }
-    return overlap;
-}
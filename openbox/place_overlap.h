@@ -22,4 +22,5 @@ void place_overlap_find_least_placement(const Rect* client_rects,
                                         int n_client_rects,
                                         const Rect* bounds,
                                         const Size* req_size,
+                                        gboolean center,
                                         Point* result);
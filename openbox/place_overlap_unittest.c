@@ -0,0 +1,236 @@
+#include "obt/unittest_base.h"
+
+#include "openbox/place_overlap.h"
+
+#include <glib.h>
+
+/* The placement done the slow way, by adding up the overlap with every
+   client rect for every placement, in the order which the placement is
+   chosen in. */
+static int reference_overlap(const Rect* client_rects,
+                             int n_client_rects,
+                             const Rect* r)
+{
+    int overlap = 0;
+    int i;
+    for (i = 0; i < n_client_rects; ++i) {
+        if (RECT_INTERSECTS_RECT(*r, client_rects[i])) {
+            Rect rtemp;
+            RECT_SET_INTERSECTION(rtemp, *r, client_rects[i]);
+            overlap += RECT_AREA(rtemp);
+        }
+    }
+    return overlap;
+}
+
+static int compare_ints(gconstpointer a, gconstpointer b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+static GArray* reference_edges(const Rect* client_rects,
+                               int n_client_rects,
+                               const Rect* monitor,
+                               gboolean vertical)
+{
+    GArray* edges = g_array_new(FALSE, FALSE, sizeof(int));
+    int i, e;
+    for (i = 0; i < n_client_rects; ++i) {
+        if (!RECT_INTERSECTS_RECT(client_rects[i], *monitor))
+            continue;
+        e = vertical ? client_rects[i].y : client_rects[i].x;
+        g_array_append_val(edges, e);
+        e += vertical ? client_rects[i].height : client_rects[i].width;
+        g_array_append_val(edges, e);
+    }
+    e = vertical ? monitor->y : monitor->x;
+    g_array_append_val(edges, e);
+    e += vertical ? monitor->height : monitor->width;
+    g_array_append_val(edges, e);
+    g_array_sort(edges, compare_ints);
+    return edges;
+}
+
+static void reference_placement(const Rect* client_rects,
+                                int n_client_rects,
+                                const Rect* monitor,
+                                const Size* req_size,
+                                Point* result)
+{
+    static const Size directions[4] = {
+        {0, 0}, {0, -1}, {-1, 0}, {-1, -1}
+    };
+    GArray* x_edges = reference_edges(client_rects, n_client_rects,
+                                      monitor, FALSE);
+    GArray* y_edges = reference_edges(client_rects, n_client_rects,
+                                      monitor, TRUE);
+    int overlap = G_MAXINT;
+    guint i, j;
+    int d;
+
+    POINT_SET(*result, monitor->x, monitor->y);
+    for (i = 0; i < x_edges->len && overlap; ++i) {
+        /* the same edge twice gives the same placements */
+        if (i && g_array_index(x_edges, int, i) ==
+            g_array_index(x_edges, int, i - 1))
+            continue;
+        for (j = 0; j < y_edges->len && overlap; ++j) {
+            if (j && g_array_index(y_edges, int, j) ==
+                g_array_index(y_edges, int, j - 1))
+                continue;
+            for (d = 0; d < 4 && overlap; ++d) {
+                Rect r;
+                RECT_SET(r,
+                         g_array_index(x_edges, int, i) +
+                         req_size->width * directions[d].width,
+                         g_array_index(y_edges, int, j) +
+                         req_size->height * directions[d].height,
+                         req_size->width, req_size->height);
+                if (!RECT_CONTAINS_RECT(*monitor, r))
+                    continue;
+                int this_overlap =
+                    reference_overlap(client_rects, n_client_rects, &r);
+                if (this_overlap < overlap) {
+                    overlap = this_overlap;
+                    POINT_SET(*result, r.x, r.y);
+                }
+            }
+        }
+    }
+    g_array_free(x_edges, TRUE);
+    g_array_free(y_edges, TRUE);
+}
+
+/* Makes n windows of random sizes, some of them hanging off the monitor */
+static Rect* random_rects(GRand* rand, int n, const Rect* monitor)
+{
+    Rect* rects = g_new(Rect, n);
+    int i;
+    for (i = 0; i < n; ++i)
+        RECT_SET(rects[i],
+                 g_rand_int_range(rand, monitor->x - 100,
+                                  monitor->x + monitor->width),
+                 g_rand_int_range(rand, monitor->y - 100,
+                                  monitor->y + monitor->height),
+                 g_rand_int_range(rand, 1, monitor->width / 2),
+                 g_rand_int_range(rand, 1, monitor->height / 2));
+    return rects;
+}
+
+static void empty_monitor() {
+    TEST_START();
+
+    Rect monitor = {100, 50, 1280, 1024};
+    Size size = {400, 300};
+    Point result;
+
+    place_overlap_find_least_placement(NULL, 0, &monitor, &size, FALSE,
+                                       &result);
+    EXPECT_INT_EQ(100, result.x);
+    EXPECT_INT_EQ(50, result.y);
+
+    /* centered in the whole monitor */
+    place_overlap_find_least_placement(NULL, 0, &monitor, &size, TRUE,
+                                       &result);
+    EXPECT_INT_EQ(100 + (1280 - 400) / 2, result.x);
+    EXPECT_INT_EQ(50 + (1024 - 300) / 2, result.y);
+
+    TEST_END();
+}
+
+static void beside_window() {
+    TEST_START();
+
+    Rect monitor = {0, 0, 1000, 1000};
+    Rect client_rects[1] = {{0, 0, 600, 1000}};
+    Size size = {300, 200};
+    Point result;
+
+    place_overlap_find_least_placement(client_rects, 1, &monitor, &size,
+                                       FALSE, &result);
+    EXPECT_INT_EQ(600, result.x);
+    EXPECT_INT_EQ(0, result.y);
+
+    TEST_END();
+}
+
+static void least_overlap() {
+    TEST_START();
+
+    /* there is no room, so it goes where it covers the least */
+    Rect monitor = {0, 0, 1000, 1000};
+    Rect client_rects[2] = {{0, 0, 1000, 600}, {0, 0, 1000, 1000}};
+    Size size = {500, 500};
+    Point result;
+
+    place_overlap_find_least_placement(client_rects, 2, &monitor, &size,
+                                       FALSE, &result);
+    EXPECT_INT_EQ(0, result.x);
+    EXPECT_INT_EQ(500, result.y);
+
+    TEST_END();
+}
+
+static void same_as_reference() {
+    TEST_START();
+
+    GRand* rand = g_rand_new_with_seed(42);
+    Rect monitor = {0, 0, 1920, 1080};
+    int trial;
+
+    for (trial = 0; trial < 200; ++trial) {
+        int n = g_rand_int_range(rand, 0, 50);
+        Rect* rects = random_rects(rand, n, &monitor);
+        Size size = {g_rand_int_range(rand, 1, 1000),
+                     g_rand_int_range(rand, 1, 800)};
+        Point expected, actual;
+
+        reference_placement(rects, n, &monitor, &size, &expected);
+        place_overlap_find_least_placement(rects, n, &monitor, &size, FALSE,
+                                           &actual);
+        EXPECT_INT_EQ(expected.x, actual.x);
+        EXPECT_INT_EQ(expected.y, actual.y);
+        g_free(rects);
+    }
+    g_rand_free(rand);
+
+    TEST_END();
+}
+
+static void many_windows() {
+    TEST_START();
+
+    static const int sizes[] = {10, 50, 100, 500, 1000, 2000};
+    GRand* rand = g_rand_new_with_seed(7);
+    Rect monitor = {0, 0, 1920, 1080};
+    Size size = {640, 480};
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); ++i) {
+        Rect* rects = random_rects(rand, sizes[i], &monitor);
+        Point result;
+
+        place_overlap_find_least_placement(rects, sizes[i], &monitor, &size,
+                                           FALSE, &result);
+        EXPECT_BOOL_EQ(TRUE, result.x >= monitor.x &&
+                       result.x + size.width <= monitor.x + monitor.width);
+        EXPECT_BOOL_EQ(TRUE, result.y >= monitor.y &&
+                       result.y + size.height <= monitor.y + monitor.height);
+        g_free(rects);
+    }
+    g_rand_free(rand);
+
+    TEST_END();
+}
+
+void run_place_overlap_unittest() {
+    unittest_start_suite("place_overlap");
+
+    empty_monitor();
+    beside_window();
+    least_overlap();
+    same_as_reference();
+    many_windows();
+
+    unittest_end_suite();
+}
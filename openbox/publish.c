@@ -0,0 +1,65 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   publish.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "publish.h"
+
+/*! The ObPublishFunc for each changed property, in the order they were
+  first marked */
+static GSList *dirty = NULL;
+static guint flush_id = 0;
+
+static gboolean flush_func(gpointer data)
+{
+    flush_id = 0;
+    publish_flush();
+    return FALSE; /* don't repeat */
+}
+
+void publish_shutdown(gboolean reconfig)
+{
+    if (reconfig) return;
+
+    if (flush_id) g_source_remove(flush_id);
+    flush_id = 0;
+    g_slist_free(dirty);
+    dirty = NULL;
+}
+
+void publish_later(ObPublishFunc func)
+{
+    if (g_slist_find(dirty, func)) return;
+
+    dirty = g_slist_append(dirty, func);
+
+    /* this runs after the events which are waiting now, as they are at the
+       same priority and were there first */
+    if (!flush_id)
+        flush_id = g_idle_add_full(G_PRIORITY_DEFAULT, flush_func,
+                                   NULL, NULL);
+}
+
+void publish_flush(void)
+{
+    while (dirty) {
+        ObPublishFunc func = dirty->data;
+
+        /* a func can mark other properties */
+        dirty = g_slist_delete_link(dirty, dirty);
+        func();
+    }
+}
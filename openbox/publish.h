@@ -0,0 +1,38 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   publish.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __publish_h
+#define __publish_h
+
+#include <glib.h>
+
+/*! Writes a property on the root window from the current state */
+typedef void (*ObPublishFunc)(void);
+
+/*! Drops anything which was not written yet when exiting */
+void publish_shutdown(gboolean reconfig);
+
+/*! Marks a root window property as changed.  The @func is called once at the
+  end of the main loop iteration, no matter how many times it was marked, so
+  that pagers only see the final value. */
+void publish_later(ObPublishFunc func);
+
+/*! Write all of the changed properties now */
+void publish_flush(void);
+
+#endif
@@ -24,6 +24,7 @@
 #include "screen.h"
 #include "dock.h"
 #include "config.h"
+#include "spatial.h"
 
 #include <glib.h>
 
@@ -99,22 +100,38 @@ static gboolean resist_move_window(Rect window,
     return snapx && snapy;
 }
 
+/*! Returns the clients which are shown near enough to @area to be snapped
+  to, from the highest to the lowest */
+static GSList* find_targets(const Rect *area, gint resist)
+{
+    Rect r = *area;
+
+    r.x -= resist + 1;
+    r.y -= resist + 1;
+    r.width += 2 * (resist + 1);
+    r.height += 2 * (resist + 1);
+    return g_slist_sort(spatial_find_rect(&r, screen_desktop, TRUE),
+                        stacking_compare);
+}
+
 void resist_move_windows(ObClient *c, gint resist, gint *x, gint *y)
 {
-    GList *it;
-    Rect dock_area;
+    GSList *it, *targets;
+    Rect dock_area, moved;
 
     if (!resist) return;
 
     frame_client_gravity(c->frame, x, y);
 
+    /* only windows between where we are and where we are going can be
+       snapped to */
+    RECT_SET(moved, MIN(*x, c->frame->area.x), MIN(*y, c->frame->area.y),
+             c->frame->area.width + ABS(*x - c->frame->area.x),
+             c->frame->area.height + ABS(*y - c->frame->area.y));
+    targets = find_targets(&moved, resist);
 
-    for (it = stacking_list; it; it = g_list_next(it)) {
-        ObClient *target;
-
-        if (!WINDOW_IS_CLIENT(it->data))
-            continue;
-        target = it->data;
+    for (it = targets; it; it = g_slist_next(it)) {
+        ObClient *target = it->data;
 
         /* don't snap to self or non-visibles */
         if (!target->frame->visible || target == c)
@@ -127,6 +144,7 @@ void resist_move_windows(ObClient *c, gint resist, gint *x, gint *y)
                                resist, x, y))
             break;
     }
+    g_slist_free(targets);
     dock_get_area(&dock_area);
     resist_move_window(c->frame->area, dock_area, resist, x, y);
 
@@ -292,15 +310,21 @@ static gboolean resist_size_window(Rect window, Rect target, gint resist,
 void resist_size_windows(ObClient *c, gint resist, gint *w, gint *h,
                          ObDirection dir)
 {
-    GList *it;
+    GSList *it, *targets;
     ObClient *target; /* target */
-    Rect dock_area;
+    Rect dock_area, sized;
+    gint dw, dh;
 
     if (!resist) return;
 
-    for (it = stacking_list; it; it = g_list_next(it)) {
-        if (!WINDOW_IS_CLIENT(it->data))
-            continue;
+    /* only windows within the change in size can be snapped to */
+    dw = ABS(*w - c->frame->area.width);
+    dh = ABS(*h - c->frame->area.height);
+    RECT_SET(sized, c->frame->area.x - dw, c->frame->area.y - dh,
+             c->frame->area.width + 2 * dw, c->frame->area.height + 2 * dh);
+    targets = find_targets(&sized, resist);
+
+    for (it = targets; it; it = g_slist_next(it)) {
         target = it->data;
 
         /* don't snap to invisibles or ourself */
@@ -314,6 +338,7 @@ void resist_size_windows(ObClient *c, gint resist, gint *w, gint *h,
                                resist, w, h, dir))
             break;
     }
+    g_slist_free(targets);
     dock_get_area(&dock_area);
     resist_size_window(c->frame->area, dock_area,
                        resist, w, h, dir);
@@ -32,12 +32,15 @@
 #include "focus.h"
 #include "focus_cycle.h"
 #include "popup.h"
+#include "publish.h"
+#include "spatial.h"
 #include "version.h"
 #include "obrender/render.h"
 #include "gettext.h"
 #include "obt/display.h"
 #include "obt/xqueue.h"
 #include "obt/prop.h"
+#include "obt/signal.h"
 
 #include <X11/Xlib.h>
 #ifdef HAVE_UNISTD_H
@@ -56,9 +59,11 @@ static gboolean screen_validate_layout(ObDesktopLayout *l);
 static gboolean replace_wm(void);
 static void     screen_tell_ksplash(void);
 static void     screen_fallback_focus(void);
+static void     free_work_areas(void);
 
 guint                  screen_num_desktops;
 guint                  screen_num_monitors;
+guint                  screen_monitors_serial;
 guint                  screen_desktop;
 guint                  screen_last_desktop;
 ObScreenShowDestopMode screen_show_desktop_mode;
@@ -79,10 +84,42 @@ static GSList *struts_left = NULL;
 static GSList *struts_right = NULL;
 static GSList *struts_bottom = NULL;
 
+/*! The struts which are in effect on a desktop, as StrutPartial*s */
+typedef struct {
+    GSList *left;
+    GSList *top;
+    GSList *right;
+    GSList *bottom;
+} ObDesktopStruts;
+
+/*! The struts for each desktop, followed by the ones for any desktop */
+static ObDesktopStruts *desktop_struts = NULL;
+/*! The work area for each desktop (and then for any desktop), on each monitor
+  (and then on all of them) */
+static Rect *work_areas = NULL;
+/*! The number of desktops and monitors the work_areas were made for */
+static guint work_areas_desktops = 0;
+static guint work_areas_monitors = 0;
+/*! If the struts have changed since the work_areas were made */
+static gboolean work_areas_changed = TRUE;
+/*! The furthest edges of any monitor */
+static gint monitors_left, monitors_top, monitors_right, monitors_bottom;
+
+/*! The clients on each desktop, followed by the ones on all desktops */
+static GList **desktop_clients = NULL;
+/*! The number of desktops which desktop_clients has lists for */
+static guint desktop_clients_num = 0;
+
 static ObPagerPopup *desktop_popup;
 static guint         desktop_popup_timer = 0;
 static gboolean      desktop_popup_perm;
 
+/*! The pointer's position, as last seen in an event */
+static gint          pointer_x;
+static gint          pointer_y;
+/*! If the pointer is known to still be at pointer_x and pointer_y */
+static gboolean      pointer_known = FALSE;
+
 /*! The number of microseconds that you need to be on a desktop before it will
   replace the remembered "last desktop" */
 #define REMEMBER_LAST_DESKTOP_TIME 750
@@ -114,7 +151,7 @@ static gboolean replace_wm(void)
         XSync(obt_display, FALSE);
 
         obt_display_ignore_errors(FALSE);
-        if (obt_display_error_occured)
+        if (obt_display_error_occured())
             current_wm_sn_owner = None;
     }
 
@@ -187,7 +224,7 @@ gboolean screen_annex(void)
     obt_display_ignore_errors(TRUE);
     XSelectInput(obt_display, obt_root(ob_screen), ROOT_EVENTMASK);
     obt_display_ignore_errors(FALSE);
-    if (obt_display_error_occured) {
+    if (obt_display_error_occured()) {
         g_message(_("A window manager is already running on screen %d"),
                   ob_screen);
 
@@ -195,6 +232,9 @@ gboolean screen_annex(void)
         return FALSE;
     }
 
+    /* we get PropertyNotify events for the root window now */
+    obt_prop_cache_watch(obt_root(ob_screen));
+
     screen_set_root_cursor();
 
     /* set the OPENBOX_PID hint */
@@ -301,6 +341,7 @@ gboolean screen_annex(void)
     supported[i++] = OBT_PROP_ATOM(OB_CONFIG_FILE);
     supported[i++] = OBT_PROP_ATOM(OB_CONTROL);
     supported[i++] = OBT_PROP_ATOM(OB_VERSION);
+    supported[i++] = OBT_PROP_ATOM(OB_IPC_SOCKET);
     supported[i++] = OBT_PROP_ATOM(OB_APP_ROLE);
     supported[i++] = OBT_PROP_ATOM(OB_APP_TITLE);
     supported[i++] = OBT_PROP_ATOM(OB_APP_NAME);
@@ -339,7 +380,7 @@ static void screen_tell_ksplash(void)
     g_spawn_async(NULL, argv, NULL,
                   G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
                   G_SPAWN_STDERR_TO_DEV_NULL | G_SPAWN_STDOUT_TO_DEV_NULL,
-                  NULL, NULL, NULL, NULL);
+                  obt_signal_child_setup, NULL, NULL, NULL);
     g_strfreev(argv);
 
     /* i'm not sure why we do this, kwin does it, but ksplash doesn't seem to
@@ -371,6 +412,9 @@ void screen_startup(gboolean reconfig)
         pager_popup_text_width_to_strings(desktop_popup,
                                           screen_desktop_names,
                                           screen_num_desktops);
+        /* the primary monitor may have changed, which changes what monitor
+           things are found on */
+        ++screen_monitors_serial;
         return;
     }
 
@@ -460,12 +504,15 @@ void screen_startup(gboolean reconfig)
 
 void screen_shutdown(gboolean reconfig)
 {
+    guint i;
+
     pager_popup_free(desktop_popup);
 
     if (reconfig)
         return;
 
     XSelectInput(obt_display, obt_root(ob_screen), NoEventMask);
+    obt_prop_cache_unwatch(obt_root(ob_screen));
 
     /* we're not running here no more! */
     OBT_PROP_ERASE(obt_root(ob_screen), OPENBOX_PID);
@@ -478,6 +525,16 @@ void screen_shutdown(gboolean reconfig)
 
     g_strfreev(screen_desktop_names);
     screen_desktop_names = NULL;
+
+    free_work_areas();
+    g_free(work_areas);
+    work_areas = NULL;
+
+    for (i = 0; i <= desktop_clients_num; ++i)
+        g_list_free(desktop_clients[i]);
+    g_free(desktop_clients);
+    desktop_clients = NULL;
+    desktop_clients_num = 0;
 }
 
 void screen_resize(void)
@@ -507,6 +564,46 @@ void screen_resize(void)
     }
 }
 
+static GList** desktop_client_list(guint desktop)
+{
+    if (desktop == DESKTOP_ALL)
+        return &desktop_clients[desktop_clients_num];
+    g_assert(desktop < desktop_clients_num);
+    return &desktop_clients[desktop];
+}
+
+/*! Changes the number of desktops which have a list of clients.  The
+  desktops being removed must not have any clients left on them. */
+static void resize_desktop_clients(guint num)
+{
+    GList *sticky;
+    guint i;
+
+    if (desktop_clients && num == desktop_clients_num) return;
+
+    sticky = desktop_clients ? desktop_clients[desktop_clients_num] : NULL;
+    for (i = num; i < desktop_clients_num; ++i)
+        g_assert(desktop_clients[i] == NULL);
+
+    desktop_clients = g_renew(GList*, desktop_clients, num + 1);
+    for (i = desktop_clients_num; i < num; ++i)
+        desktop_clients[i] = NULL;
+    desktop_clients[num] = sticky;
+    desktop_clients_num = num;
+}
+
+void screen_add_desktop_client(ObClient *c)
+{
+    GList **l = desktop_client_list(c->desktop);
+    *l = g_list_prepend(*l, c);
+}
+
+void screen_remove_desktop_client(ObClient *c)
+{
+    GList **l = desktop_client_list(c->desktop);
+    *l = g_list_remove(*l, c);
+}
+
 void screen_set_num_desktops(guint num)
 {
     gulong *viewport;
@@ -519,6 +616,10 @@ void screen_set_num_desktops(guint num)
     screen_num_desktops = num;
     OBT_PROP_SET32(obt_root(ob_screen), NET_NUMBER_OF_DESKTOPS, CARDINAL, num);
 
+    /* keep the lists for the desktops being removed until their windows
+       are moved off of them */
+    resize_desktop_clients(MAX(num, desktop_clients_num));
+
     /* set the viewport hint */
     viewport = g_new0(gulong, num * 2);
     OBT_PROP_SETA32(obt_root(ob_screen),
@@ -546,6 +647,8 @@ void screen_set_num_desktops(guint num)
     }
     g_list_free(stacking_copy);
 
+    resize_desktop_clients(num);
+
     /* change our struts/area to match (after moving windows) */
     screen_update_areas();
 
@@ -599,6 +702,12 @@ static void screen_fallback_focus(void)
     }
 }
 
+static void screen_write_desktop(void)
+{
+    OBT_PROP_SET32(obt_root(ob_screen), NET_CURRENT_DESKTOP, CARDINAL,
+                   screen_desktop);
+}
+
 static gboolean last_desktop_func(gpointer data)
 {
     screen_desktop_timeout = TRUE;
@@ -608,9 +717,10 @@ static gboolean last_desktop_func(gpointer data)
 
 void screen_set_desktop(guint num, gboolean dofocus)
 {
-    GList *it;
+    GList *it, *changing;
     guint previous;
     gulong ignore_start;
+    gint64 ms;
 
     g_assert(num < screen_num_desktops);
 
@@ -619,7 +729,7 @@ void screen_set_desktop(guint num, gboolean dofocus)
 
     if (previous == num) return;
 
-    OBT_PROP_SET32(obt_root(ob_screen), NET_CURRENT_DESKTOP, CARDINAL, num);
+    publish_later(screen_write_desktop);
 
     /* This whole thing decides when/how to save the screen_last_desktop so
        that it can be restored later if you want */
@@ -700,37 +810,48 @@ void screen_set_desktop(guint num, gboolean dofocus)
     if (moveresize_client)
         client_set_desktop(moveresize_client, num, TRUE, FALSE);
 
+    /* only the windows on the old and new desktops can be shown or hidden,
+       as the ones on all desktops stay where they are.  the old desktop may
+       be gone already, if its windows were moved to another one. */
+    changing = g_list_copy(*desktop_client_list(num));
+    if (previous < desktop_clients_num)
+        changing = g_list_concat(changing,
+                                 g_list_copy(*desktop_client_list(previous)));
+    changing = g_list_sort(changing, stacking_compare);
+
+    client_showhide_begin();
+
     /* show windows before hiding the rest to lessen the enter/leave events */
 
     /* show windows from top to bottom */
-    for (it = stacking_list; it; it = g_list_next(it)) {
-        if (WINDOW_IS_CLIENT(it->data)) {
-            ObClient *c = it->data;
-            client_show(c);
-        }
-    }
+    for (it = changing; it; it = g_list_next(it))
+        client_show(it->data);
 
     if (dofocus) screen_fallback_focus();
 
     /* hide windows from bottom to top */
-    for (it = g_list_last(stacking_list); it; it = g_list_previous(it)) {
-        if (WINDOW_IS_CLIENT(it->data)) {
-            ObClient *c = it->data;
-            if (client_hide(c)) {
-                if (c == focus_client) {
-                    /* c was focused and we didn't do fallback clearly so make
-                       sure openbox doesnt still consider the window focused.
-                       this happens when using NextWindow with allDesktops,
-                       since it doesnt want to move focus on desktop change,
-                       but the focus is not going to stay with the current
-                       window, which has now disappeared.
-                       only do this if the client was actually hidden,
-                       otherwise it can keep focus. */
-                    focus_set_client(NULL);
-                }
+    for (it = g_list_last(changing); it; it = g_list_previous(it)) {
+        ObClient *c = it->data;
+        if (client_hide(c)) {
+            if (c == focus_client) {
+                /* c was focused and we didn't do fallback clearly so make
+                   sure openbox doesnt still consider the window focused.
+                   this happens when using NextWindow with allDesktops,
+                   since it doesnt want to move focus on desktop change,
+                   but the focus is not going to stay with the current
+                   window, which has now disappeared.
+                   only do this if the client was actually hidden,
+                   otherwise it can keep focus. */
+                focus_set_client(NULL);
             }
         }
     }
+    g_list_free(changing);
+
+    client_showhide_end();
+    if ((ms = event_handling_ms()) >= 0)
+        ob_debug_type(OB_DEBUG_LATENCY, "Switched to desktop %u in %"
+                      G_GINT64_FORMAT " ms", num + 1, ms);
 
     focus_cycle_addremove(NULL, TRUE);
 
@@ -1221,6 +1342,7 @@ void screen_update_desktop_names(void)
 void screen_show_desktop(ObScreenShowDestopMode show_mode, ObClient *show_only)
 {
     GList *it;
+    gint64 ms;
 
     ObScreenShowDestopMode before_mode = screen_show_desktop_mode;
 
@@ -1244,6 +1366,8 @@ void screen_show_desktop(ObScreenShowDestopMode show_mode, ObClient *show_only)
         return;
     }
 
+    client_showhide_begin();
+
     if (showing_after) {
         /* hide windows bottom to top */
         for (it = g_list_last(stacking_list); it; it = g_list_previous(it)) {
@@ -1268,6 +1392,12 @@ void screen_show_desktop(ObScreenShowDestopMode show_mode, ObClient *show_only)
         }
     }
 
+    client_showhide_end();
+    if ((ms = event_handling_ms()) >= 0)
+        ob_debug_type(OB_DEBUG_LATENCY, "%s the desktop in %"
+                      G_GINT64_FORMAT " ms",
+                      showing_after ? "Showed" : "Stopped showing", ms);
+
     if (showing_after) {
         /* focus the desktop */
         for (it = focus_order; it; it = g_list_next(it)) {
@@ -1332,6 +1462,8 @@ void screen_install_colormap(ObClient *client, gboolean install)
 typedef struct {
     guint desktop;
     StrutPartial *strut;
+    /*! The client the strut belongs to, or NULL */
+    ObClient *client;
 } ObScreenStrut;
 
 #define RESET_STRUT_LIST(sl) \
@@ -1340,14 +1472,45 @@ typedef struct {
         sl = g_slist_delete_link(sl, sl); \
     }
 
-#define ADD_STRUT_TO_LIST(sl, d, s) \
+#define ADD_STRUT_TO_LIST(sl, d, s, c) \
 { \
     ObScreenStrut *ss = g_slice_new(ObScreenStrut); \
     ss->desktop = d; \
     ss->strut = s;  \
+    ss->client = c; \
     sl = g_slist_prepend(sl, ss); \
 }
 
+static void add_client_struts(ObClient *c)
+{
+    if (c->strut.left)
+        ADD_STRUT_TO_LIST(struts_left, c->desktop, &c->strut, c);
+    if (c->strut.top)
+        ADD_STRUT_TO_LIST(struts_top, c->desktop, &c->strut, c);
+    if (c->strut.right)
+        ADD_STRUT_TO_LIST(struts_right, c->desktop, &c->strut, c);
+    if (c->strut.bottom)
+        ADD_STRUT_TO_LIST(struts_bottom, c->desktop, &c->strut, c);
+}
+
+/*! Removes the client's strut from the list, and returns TRUE if it was
+  there, setting @desktop to the desktop it was added on */
+static gboolean remove_client_strut(GSList **sl, ObClient *c, guint *desktop)
+{
+    GSList *it;
+
+    for (it = *sl; it; it = g_slist_next(it)) {
+        ObScreenStrut *ss = it->data;
+        if (ss->client == c) {
+            *desktop = ss->desktop;
+            g_slice_free(ObScreenStrut, ss);
+            *sl = g_slist_delete_link(*sl, it);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 #define VALIDATE_STRUTS(sl, side, max) \
 { \
     GSList *it; \
@@ -1415,10 +1578,29 @@ static void get_xinerama_screens(Rect **xin_areas, guint *nxin)
              (*xin_areas)[i].width, (*xin_areas)[i].height);
 }
 
-void screen_update_areas(void)
+static void screen_write_workarea(void)
 {
     guint i;
     gulong *dims;
+
+    dims = g_new(gulong, 4 * screen_num_desktops);
+    for (i = 0; i < screen_num_desktops; ++i) {
+        const Rect *area = screen_work_area(i, SCREEN_AREA_ALL_MONITORS);
+        dims[i*4+0] = area->x;
+        dims[i*4+1] = area->y;
+        dims[i*4+2] = area->width;
+        dims[i*4+3] = area->height;
+    }
+
+    /* set the legacy workarea hint to the union of all the monitors */
+    OBT_PROP_SETA32(obt_root(ob_screen), NET_WORKAREA, CARDINAL,
+                    dims, 4 * screen_num_desktops);
+
+    g_free(dims);
+}
+
+void screen_update_areas(void)
+{
     GList *it, *onscreen;
 
     /* collect the clients that are on screen */
@@ -1430,6 +1612,10 @@ void screen_update_areas(void)
 
     g_free(monitor_area);
     get_xinerama_screens(&monitor_area, &screen_num_monitors);
+    ++screen_monitors_serial;
+
+    /* the grid covers all the monitors, for each desktop */
+    spatial_resize();
 
     /* set up the user-specified margins */
     config_margins.top_start = RECT_LEFT(monitor_area[screen_num_monitors]);
@@ -1447,34 +1633,25 @@ void screen_update_areas(void)
     RESET_STRUT_LIST(struts_bottom);
 
     /* collect the struts */
-    //for (it = client_list; it; it = g_list_next(it)) {
-    //    ObClient *c = it->data;
-    //    if (c->strut.left)
-    //        ADD_STRUT_TO_LIST(struts_left, c->desktop, &c->strut);
-    //    if (c->strut.top)
-    //        ADD_STRUT_TO_LIST(struts_top, c->desktop, &c->strut);
-    //    if (c->strut.right)
-    //        ADD_STRUT_TO_LIST(struts_right, c->desktop, &c->strut);
-    //    if (c->strut.bottom)
-    //        ADD_STRUT_TO_LIST(struts_bottom, c->desktop, &c->strut);
-    //}
+    for (it = client_list; it; it = g_list_next(it))
+        add_client_struts(it->data);
     if (dock_strut.left)
-        ADD_STRUT_TO_LIST(struts_left, DESKTOP_ALL, &dock_strut);
+        ADD_STRUT_TO_LIST(struts_left, DESKTOP_ALL, &dock_strut, NULL);
     if (dock_strut.top)
-        ADD_STRUT_TO_LIST(struts_top, DESKTOP_ALL, &dock_strut);
+        ADD_STRUT_TO_LIST(struts_top, DESKTOP_ALL, &dock_strut, NULL);
     if (dock_strut.right)
-        ADD_STRUT_TO_LIST(struts_right, DESKTOP_ALL, &dock_strut);
+        ADD_STRUT_TO_LIST(struts_right, DESKTOP_ALL, &dock_strut, NULL);
     if (dock_strut.bottom)
-        ADD_STRUT_TO_LIST(struts_bottom, DESKTOP_ALL, &dock_strut);
+        ADD_STRUT_TO_LIST(struts_bottom, DESKTOP_ALL, &dock_strut, NULL);
 
     if (config_margins.left)
-        ADD_STRUT_TO_LIST(struts_left, DESKTOP_ALL, &config_margins);
+        ADD_STRUT_TO_LIST(struts_left, DESKTOP_ALL, &config_margins, NULL);
     if (config_margins.top)
-        ADD_STRUT_TO_LIST(struts_top, DESKTOP_ALL, &config_margins);
+        ADD_STRUT_TO_LIST(struts_top, DESKTOP_ALL, &config_margins, NULL);
     if (config_margins.right)
-        ADD_STRUT_TO_LIST(struts_right, DESKTOP_ALL, &config_margins);
+        ADD_STRUT_TO_LIST(struts_right, DESKTOP_ALL, &config_margins, NULL);
     if (config_margins.bottom)
-        ADD_STRUT_TO_LIST(struts_bottom, DESKTOP_ALL, &config_margins);
+        ADD_STRUT_TO_LIST(struts_bottom, DESKTOP_ALL, &config_margins, NULL);
 
     VALIDATE_STRUTS(struts_left, left,
                     monitor_area[screen_num_monitors].width / 2);
@@ -1485,25 +1662,14 @@ void screen_update_areas(void)
     VALIDATE_STRUTS(struts_bottom, bottom,
                     monitor_area[screen_num_monitors].height / 2);
 
-    dims = g_new(gulong, 4 * screen_num_desktops);
-    for (i = 0; i < screen_num_desktops; ++i) {
-        Rect *area = screen_area(i, SCREEN_AREA_ALL_MONITORS, NULL);
-        dims[i*4+0] = area->x;
-        dims[i*4+1] = area->y;
-        dims[i*4+2] = area->width;
-        dims[i*4+3] = area->height;
-        g_slice_free(Rect, area);
-    }
+    /* find the work areas again the next time they are used */
+    work_areas_changed = TRUE;
 
-    /* set the legacy workarea hint to the union of all the monitors */
-    OBT_PROP_SETA32(obt_root(ob_screen), NET_WORKAREA, CARDINAL,
-                    dims, 4 * screen_num_desktops);
+    publish_later(screen_write_workarea);
 
     /* the area has changed, adjust all the windows if they need it */
     for (it = onscreen; it; it = g_list_next(it))
         client_reconfigure(it->data, FALSE);
-
-    g_free(dims);
 }
 
 #if 0
@@ -1548,40 +1714,24 @@ Rect* screen_area_all_monitors(guint desktop)
 
 #define STRUT_LEFT_IGNORE(s, us, search) \
     (head == SCREEN_AREA_ALL_MONITORS && us && \
-     RECT_LEFT(monitor_area[i]) + s->left > RECT_LEFT(*search))
+     monitors_left + s->left > RECT_LEFT(*search))
 #define STRUT_RIGHT_IGNORE(s, us, search) \
     (head == SCREEN_AREA_ALL_MONITORS && us && \
-     RECT_RIGHT(monitor_area[i]) - s->right < RECT_RIGHT(*search))
+     monitors_right - s->right < RECT_RIGHT(*search))
 #define STRUT_TOP_IGNORE(s, us, search) \
     (head == SCREEN_AREA_ALL_MONITORS && us && \
-     RECT_TOP(monitor_area[i]) + s->top > RECT_TOP(*search))
+     monitors_top + s->top > RECT_TOP(*search))
 #define STRUT_BOTTOM_IGNORE(s, us, search) \
     (head == SCREEN_AREA_ALL_MONITORS && us && \
-     RECT_BOTTOM(monitor_area[i]) - s->bottom < RECT_BOTTOM(*search))
+     monitors_bottom - s->bottom < RECT_BOTTOM(*search))
 
-Rect* screen_area(guint desktop, guint head, Rect *search)
+static void find_area(guint desktop, guint head, const Rect *search,
+                      gboolean us, Rect *a)
 {
-    Rect *a;
+    const ObDesktopStruts *ds;
     GSList *it;
     gint l, r, t, b;
-    guint i, d;
-    gboolean us = search != NULL; /* user provided search */
-
-    g_assert(desktop < screen_num_desktops || desktop == DESKTOP_ALL);
-    g_assert(head < screen_num_monitors || head == SCREEN_AREA_ONE_MONITOR ||
-             head == SCREEN_AREA_ALL_MONITORS);
-    g_assert(!(head == SCREEN_AREA_ONE_MONITOR && search == NULL));
-
-    /* find any struts for this monitor
-       which will be affecting the search area.
-    */
-
-    /* search everything if search is null */
-    if (!search) {
-        if (head < screen_num_monitors) search = &monitor_area[head];
-        else search = &monitor_area[screen_num_monitors];
-    }
-    if (head == SCREEN_AREA_ONE_MONITOR) head = screen_find_monitor(search);
+    guint i;
 
     /* al is "all left" meaning the furthest left you can get, l is our
        "working left" meaning our current strut edge which we're calculating
@@ -1615,60 +1765,286 @@ Rect* screen_area(guint desktop, guint head, Rect *search)
         b = RECT_BOTTOM(monitor_area[screen_num_monitors]);
     }
 
-    for (d = 0; d < screen_num_desktops; ++d) {
-        if (d != desktop && desktop != DESKTOP_ALL) continue;
+    /* the struts are against the edges of the whole screen, so they are the
+       same for every monitor.  when searching all the monitors, a strut is
+       ignored only if it would be ignored on every one of them */
+    ds = &desktop_struts[desktop == DESKTOP_ALL ?
+                         work_areas_desktops : desktop];
+    for (it = ds->left; it; it = g_slist_next(it)) {
+        StrutPartial *s = it->data;
+        if (STRUT_LEFT_IN_SEARCH(s, search) &&
+            !STRUT_LEFT_IGNORE(s, us, search))
+            l = MAX(l, RECT_LEFT(monitor_area[screen_num_monitors])
+                       + s->left);
+    }
+    for (it = ds->top; it; it = g_slist_next(it)) {
+        StrutPartial *s = it->data;
+        if (STRUT_TOP_IN_SEARCH(s, search) &&
+            !STRUT_TOP_IGNORE(s, us, search))
+            t = MAX(t, RECT_TOP(monitor_area[screen_num_monitors])
+                       + s->top);
+    }
+    for (it = ds->right; it; it = g_slist_next(it)) {
+        StrutPartial *s = it->data;
+        if (STRUT_RIGHT_IN_SEARCH(s, search) &&
+            !STRUT_RIGHT_IGNORE(s, us, search))
+            r = MIN(r, RECT_RIGHT(monitor_area[screen_num_monitors])
+                       - s->right);
+    }
+    for (it = ds->bottom; it; it = g_slist_next(it)) {
+        StrutPartial *s = it->data;
+        if (STRUT_BOTTOM_IN_SEARCH(s, search) &&
+            !STRUT_BOTTOM_IGNORE(s, us, search))
+            b = MIN(b, RECT_BOTTOM(monitor_area[screen_num_monitors])
+                       - s->bottom);
+    }
 
-        for (i = 0; i < screen_num_monitors; ++i) {
-            if (head != SCREEN_AREA_ALL_MONITORS && head != i) continue;
-
-            for (it = struts_left; it; it = g_slist_next(it)) {
-                ObScreenStrut *s = it->data;
-                if ((s->desktop == d || s->desktop == DESKTOP_ALL) &&
-                    STRUT_LEFT_IN_SEARCH(s->strut, search) &&
-                    !STRUT_LEFT_IGNORE(s->strut, us, search))
-                    l = MAX(l, RECT_LEFT(monitor_area[screen_num_monitors])
-                               + s->strut->left);
-            }
-            for (it = struts_top; it; it = g_slist_next(it)) {
-                ObScreenStrut *s = it->data;
-                if ((s->desktop == d || s->desktop == DESKTOP_ALL) &&
-                    STRUT_TOP_IN_SEARCH(s->strut, search) &&
-                    !STRUT_TOP_IGNORE(s->strut, us, search))
-                    t = MAX(t, RECT_TOP(monitor_area[screen_num_monitors])
-                               + s->strut->top);
-            }
-            for (it = struts_right; it; it = g_slist_next(it)) {
-                ObScreenStrut *s = it->data;
-                if ((s->desktop == d || s->desktop == DESKTOP_ALL) &&
-                    STRUT_RIGHT_IN_SEARCH(s->strut, search) &&
-                    !STRUT_RIGHT_IGNORE(s->strut, us, search))
-                    r = MIN(r, RECT_RIGHT(monitor_area[screen_num_monitors])
-                               - s->strut->right);
-            }
-            for (it = struts_bottom; it; it = g_slist_next(it)) {
-                ObScreenStrut *s = it->data;
-                if ((s->desktop == d || s->desktop == DESKTOP_ALL) &&
-                    STRUT_BOTTOM_IN_SEARCH(s->strut, search) &&
-                    !STRUT_BOTTOM_IGNORE(s->strut, us, search))
-                    b = MIN(b, RECT_BOTTOM(monitor_area[screen_num_monitors])
-                               - s->strut->bottom);
-            }
+    /* limit to this monitor */
+    if (head < screen_num_monitors) {
+        l = MAX(l, RECT_LEFT(monitor_area[head]));
+        t = MAX(t, RECT_TOP(monitor_area[head]));
+        r = MIN(r, RECT_RIGHT(monitor_area[head]));
+        b = MIN(b, RECT_BOTTOM(monitor_area[head]));
+    }
 
-            /* limit to this monitor */
-            if (head == i) {
-                l = MAX(l, RECT_LEFT(monitor_area[i]));
-                t = MAX(t, RECT_TOP(monitor_area[i]));
-                r = MIN(r, RECT_RIGHT(monitor_area[i]));
-                b = MIN(b, RECT_BOTTOM(monitor_area[i]));
-            }
+    RECT_SET(*a, l, t, r - l + 1, b - t + 1);
+}
+
+static void free_work_areas(void)
+{
+    guint d;
+
+    if (!desktop_struts) return;
+
+    for (d = 0; d <= work_areas_desktops; ++d) {
+        g_slist_free(desktop_struts[d].left);
+        g_slist_free(desktop_struts[d].top);
+        g_slist_free(desktop_struts[d].right);
+        g_slist_free(desktop_struts[d].bottom);
+    }
+    g_free(desktop_struts);
+    desktop_struts = NULL;
+}
+
+/*! Returns if a strut on the desktop is in effect for the desktop_struts
+  at index @d */
+static gboolean strut_on_desktop(guint desktop, guint d)
+{
+    return (desktop == DESKTOP_ALL || desktop == d ||
+            (d == work_areas_desktops && desktop < d));
+}
+
+/*! Puts the strut in the list for every desktop it is in effect on */
+static void sort_strut(ObScreenStrut *ss, gsize offset)
+{
+    guint d;
+
+    for (d = 0; d <= work_areas_desktops; ++d)
+        if (strut_on_desktop(ss->desktop, d)) {
+            GSList **l = G_STRUCT_MEMBER_P(&desktop_struts[d], offset);
+            *l = g_slist_prepend(*l, ss->strut);
         }
+}
+
+static void sort_struts(GSList *struts, gsize offset)
+{
+    GSList *it;
+
+    for (it = struts; it; it = g_slist_next(it))
+        sort_strut(it->data, offset);
+}
+
+/*! Finds the work areas at index @d in the work_areas */
+static void find_work_areas(guint d)
+{
+    guint m;
+
+    for (m = 0; m <= work_areas_monitors; ++m)
+        find_area(d < work_areas_desktops ? d : DESKTOP_ALL,
+                  m < work_areas_monitors ? m : SCREEN_AREA_ALL_MONITORS,
+                  &monitor_area[m], FALSE,
+                  &work_areas[d * (work_areas_monitors + 1) + m]);
+}
+
+/*! Makes the work_areas again if the struts, the monitors or the number of
+  desktops have changed */
+static void update_work_areas(void)
+{
+    guint d, m;
+
+    if (!work_areas_changed && work_areas_desktops == screen_num_desktops &&
+        work_areas_monitors == screen_num_monitors)
+        return;
+
+    free_work_areas();
+
+    work_areas_desktops = screen_num_desktops;
+    work_areas_monitors = screen_num_monitors;
+
+    desktop_struts = g_new0(ObDesktopStruts, work_areas_desktops + 1);
+    sort_struts(struts_left, G_STRUCT_OFFSET(ObDesktopStruts, left));
+    sort_struts(struts_top, G_STRUCT_OFFSET(ObDesktopStruts, top));
+    sort_struts(struts_right, G_STRUCT_OFFSET(ObDesktopStruts, right));
+    sort_struts(struts_bottom, G_STRUCT_OFFSET(ObDesktopStruts, bottom));
+
+    monitors_left = monitors_top = G_MAXINT;
+    monitors_right = monitors_bottom = G_MININT;
+    for (m = 0; m < screen_num_monitors; ++m) {
+        monitors_left = MIN(monitors_left, RECT_LEFT(monitor_area[m]));
+        monitors_top = MIN(monitors_top, RECT_TOP(monitor_area[m]));
+        monitors_right = MAX(monitors_right, RECT_RIGHT(monitor_area[m]));
+        monitors_bottom = MAX(monitors_bottom, RECT_BOTTOM(monitor_area[m]));
     }
 
+    work_areas = g_renew(Rect, work_areas,
+                         (work_areas_desktops + 1) *
+                         (work_areas_monitors + 1));
+    for (d = 0; d <= work_areas_desktops; ++d)
+        find_work_areas(d);
+
+    work_areas_changed = FALSE;
+}
+
+/*! Takes the client's strut out of the struts for one side, and returns
+  TRUE if it was there, setting @desktop to the desktop it was on */
+static gboolean unsort_client_strut(GSList **sl, ObClient *c, gsize offset,
+                                    guint *desktop)
+{
+    guint d;
+
+    if (!remove_client_strut(sl, c, desktop))
+        return FALSE;
+
+    for (d = 0; d <= work_areas_desktops; ++d)
+        if (strut_on_desktop(*desktop, d)) {
+            GSList **l = G_STRUCT_MEMBER_P(&desktop_struts[d], offset);
+            *l = g_slist_remove(*l, &c->strut);
+        }
+    return TRUE;
+}
+
+void screen_update_client_strut(ObClient *c)
+{
+    guint d, m, old_desktop = DESKTOP_ALL;
+    gboolean had = FALSE, has, any = FALSE;
+    gsize n_areas;
+    Rect *old_areas;
+    gboolean *changed;
+    GList *it;
+
+    /* get the work areas from before the change */
+    update_work_areas();
+
+    had |= unsort_client_strut(&struts_left, c,
+                               G_STRUCT_OFFSET(ObDesktopStruts, left),
+                               &old_desktop);
+    had |= unsort_client_strut(&struts_top, c,
+                               G_STRUCT_OFFSET(ObDesktopStruts, top),
+                               &old_desktop);
+    had |= unsort_client_strut(&struts_right, c,
+                               G_STRUCT_OFFSET(ObDesktopStruts, right),
+                               &old_desktop);
+    had |= unsort_client_strut(&struts_bottom, c,
+                               G_STRUCT_OFFSET(ObDesktopStruts, bottom),
+                               &old_desktop);
+
+    has = c->managed && STRUT_EXISTS(c->strut);
+    if (has) {
+        /* limit it like screen_update_areas() does */
+        c->strut.left = MIN(monitor_area[screen_num_monitors].width / 2,
+                            c->strut.left);
+        c->strut.right = MIN(monitor_area[screen_num_monitors].width / 2,
+                             c->strut.right);
+        c->strut.top = MIN(monitor_area[screen_num_monitors].height / 2,
+                           c->strut.top);
+        c->strut.bottom = MIN(monitor_area[screen_num_monitors].height / 2,
+                              c->strut.bottom);
+
+        /* the new ones go at the front of the lists */
+        add_client_struts(c);
+        if (c->strut.left)
+            sort_strut(struts_left->data,
+                       G_STRUCT_OFFSET(ObDesktopStruts, left));
+        if (c->strut.top)
+            sort_strut(struts_top->data,
+                       G_STRUCT_OFFSET(ObDesktopStruts, top));
+        if (c->strut.right)
+            sort_strut(struts_right->data,
+                       G_STRUCT_OFFSET(ObDesktopStruts, right));
+        if (c->strut.bottom)
+            sort_strut(struts_bottom->data,
+                       G_STRUCT_OFFSET(ObDesktopStruts, bottom));
+    }
+
+    if (!had && !has) return;
+
+    /* find the work areas again for the desktops the strut was or is on */
+    n_areas = (work_areas_desktops + 1) * (work_areas_monitors + 1);
+    old_areas = g_memdup(work_areas, n_areas * sizeof(Rect));
+    changed = g_new0(gboolean, work_areas_desktops + 1);
+    for (d = 0; d <= work_areas_desktops; ++d) {
+        if (!(had && strut_on_desktop(old_desktop, d)) &&
+            !(has && strut_on_desktop(c->desktop, d)))
+            continue;
+
+        find_work_areas(d);
+        for (m = 0; m <= work_areas_monitors; ++m) {
+            guint i = d * (work_areas_monitors + 1) + m;
+            if (!RECT_EQUAL(old_areas[i], work_areas[i]))
+                changed[d] = any = TRUE;
+        }
+    }
+
+    if (any) {
+        publish_later(screen_write_workarea);
+
+        /* adjust the windows on the desktops where the area changed */
+        for (it = client_list; it; it = g_list_next(it)) {
+            ObClient *o = it->data;
+
+            d = (o->desktop == DESKTOP_ALL ? work_areas_desktops : o->desktop);
+            if (d <= work_areas_desktops && changed[d])
+                client_reconfigure(o, FALSE);
+        }
+    }
+
+    g_free(changed);
+    g_free(old_areas);
+}
+
+const Rect* screen_work_area(guint desktop, guint head)
+{
+    g_assert(desktop < screen_num_desktops || desktop == DESKTOP_ALL);
+    g_assert(head < screen_num_monitors || head == SCREEN_AREA_ALL_MONITORS);
+
+    update_work_areas();
+
+    if (desktop == DESKTOP_ALL) desktop = work_areas_desktops;
+    if (head == SCREEN_AREA_ALL_MONITORS) head = work_areas_monitors;
+    return &work_areas[desktop * (work_areas_monitors + 1) + head];
+}
+
+Rect* screen_area(guint desktop, guint head, Rect *search)
+{
+    Rect *a;
+
+    g_assert(desktop < screen_num_desktops || desktop == DESKTOP_ALL);
+    g_assert(head < screen_num_monitors || head == SCREEN_AREA_ONE_MONITOR ||
+             head == SCREEN_AREA_ALL_MONITORS);
+    g_assert(!(head == SCREEN_AREA_ONE_MONITOR && search == NULL));
+
+    /* the whole monitor(s) are looked up */
+    if (!search)
+        return g_slice_dup(Rect, screen_work_area(desktop, head));
+
+    /* find any struts for this monitor which will be affecting the search
+       area, using the struts sorted by desktop */
+    update_work_areas();
+
+    if (head == SCREEN_AREA_ONE_MONITOR) head = screen_find_monitor(search);
+
     a = g_slice_new(Rect);
-    a->x = l;
-    a->y = t;
-    a->width = r - l + 1;
-    a->height = b - t + 1;
+    find_area(desktop, head, search, TRUE, a);
     return a;
 }
 
@@ -1684,6 +2060,7 @@ guint screen_find_monitor(const Rect *search)
     glong mostpx = 0;
     guint closest_distance_index = screen_num_monitors;
     guint closest_distance = G_MAXUINT;
+    guint only_index = screen_num_monitors;
     GSList *counted = NULL;
 
     /* we want to count the number of pixels search has on each monitor, but not
@@ -1711,6 +2088,17 @@ guint screen_find_monitor(const Rect *search)
        vice versa for a rect in |counted| that is getting added back.
     */
 
+    /* usually the search area is on just one monitor, and then there is
+       nothing to count, so look for that first without allocating anything */
+    for (i = 0; i < screen_num_monitors; ++i)
+        if (RECT_INTERSECTS_RECT(monitor_area[i], *search)) {
+            if (only_index < screen_num_monitors)
+                break; /* it is on more than one */
+            only_index = i;
+        }
+    if (i == screen_num_monitors && only_index < screen_num_monitors)
+        return only_index;
+
     if (config_primary_monitor_index < screen_num_monitors) {
         const Rect *monitor;
         Rect on_current_monitor;
@@ -1901,6 +2289,18 @@ guint screen_monitor_pointer()
     return screen_find_monitor_point(x, y);
 }
 
+void screen_pointer_seen(gint x, gint y)
+{
+    pointer_x = x;
+    pointer_y = y;
+    pointer_known = TRUE;
+}
+
+void screen_pointer_forget(void)
+{
+    pointer_known = FALSE;
+}
+
 gboolean screen_pointer_pos(gint *x, gint *y)
 {
     Window w;
@@ -1908,6 +2308,12 @@ gboolean screen_pointer_pos(gint *x, gint *y)
     guint u;
     gboolean ret;
 
+    if (pointer_known) {
+        *x = pointer_x;
+        *y = pointer_y;
+        return TRUE;
+    }
+
     ret = !!XQueryPointer(obt_display, obt_root(ob_screen),
                           &w, &w, x, y, &i, &i, &u);
     if (!ret) {
@@ -1917,6 +2323,10 @@ gboolean screen_pointer_pos(gint *x, gint *y)
                                   &w, &w, x, y, &i, &i, &u))
                     break;
     }
+    /* while the pointer is grabbed every motion comes to us, so it stays
+       known until the grab ends */
+    else if (grab_on_pointer())
+        screen_pointer_seen(*x, *y);
     return ret;
 }
 
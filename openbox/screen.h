@@ -36,6 +36,9 @@ typedef enum {
 extern guint screen_num_desktops;
 /*! The number of virtual "xinerama" screens/heads */
 extern guint screen_num_monitors;
+/*! Changes each time the monitors are found again, so things remembered about
+  them can tell when they are out of date */
+extern guint screen_monitors_serial;
 /*! The current desktop */
 extern guint screen_desktop;
 /*! The desktop which was last visible */
@@ -113,6 +116,10 @@ void screen_update_desktop_names(void);
 void screen_install_colormap(struct _ObClient *client, gboolean install);
 
 void screen_update_areas(void);
+/*! Call when a client's strut or desktop changes, or when it is managed or
+  unmanaged.  Only the work areas of the desktops it is on are found again,
+  and only the windows on those desktops are adjusted, if they changed. */
+void screen_update_client_strut(struct _ObClient *c);
 
 const Rect* screen_physical_area_all_monitors(void);
 
@@ -152,6 +159,14 @@ const Rect* screen_physical_area_primary(gboolean fixed);
  */
 Rect* screen_area(guint desktop, guint head, Rect *search);
 
+/*! Returns the work area of the desktop on a monitor, without searching.
+  The work areas are found again only after the struts, the monitors or the
+  number of desktops change, so this does not need to allocate anything.
+  @param desktop A desktop or DESKTOP_ALL
+  @param head The number of the head or SCREEN_AREA_ALL_MONITORS
+*/
+const Rect* screen_work_area(guint desktop, guint head);
+
 gboolean screen_physical_area_monitor_contains(guint head, Rect *search);
 
 /*! Determines which physical monitor a rectangle is on by calculating the
@@ -171,6 +186,20 @@ void screen_set_root_cursor(void);
   is on this screen and FALSE if it is on another screen. */
 gboolean screen_pointer_pos(gint *x, gint *y);
 
+/*! Tells where the pointer is, from an event which was just seen for it.
+  screen_pointer_pos() gives this back without asking the server until
+  screen_pointer_forget() is called. */
+void screen_pointer_seen(gint x, gint y);
+/*! Call when the pointer may have moved without us seeing an event for it */
+void screen_pointer_forget(void);
+
+/*! Call when a client is added to the client_list, and after its desktop
+  changes, to put it in the list of clients for its desktop */
+void screen_add_desktop_client(struct _ObClient *c);
+/*! Call before a client's desktop changes, and when it is removed from the
+  client_list */
+void screen_remove_desktop_client(struct _ObClient *c);
+
 /*! Returns the monitor which contains the pointer device */
 guint screen_monitor_pointer(void);
 
@@ -0,0 +1,225 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   spatial.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "spatial.h"
+#include "client.h"
+#include "frame.h"
+#include "screen.h"
+
+/*! The width and height of each cell in the grid */
+#define CELL_SIZE 256
+
+typedef struct _ObSpatialEntry ObSpatialEntry;
+
+struct _ObSpatialEntry {
+    ObClient *client;
+    /*! The frame area the client was put in the grid with */
+    Rect area;
+    /*! The grid the client is in */
+    guint grid;
+    /*! The first and last cells of the grid which the area covers */
+    gint x1, y1, x2, y2;
+    /*! The search it was last found by, so it is found once per search */
+    guint found;
+};
+
+/*! Maps an ObClient* to its ObSpatialEntry* */
+static GHashTable *entries = NULL;
+/*! The cells of every grid, each one a list of ObSpatialEntry*.  The last
+  grid is for the clients on all desktops. */
+static GSList **cells = NULL;
+static guint num_grids = 0;
+static gint cols = 0;
+static gint rows = 0;
+/*! The area of the screen which the grids cover */
+static Rect bounds;
+static guint search = 0;
+
+static guint client_grid(ObClient *c)
+{
+    if (c->desktop == DESKTOP_ALL || c->desktop >= num_grids - 1)
+        return num_grids - 1;
+    return c->desktop;
+}
+
+static void cell_range(const Rect *r, gint *x1, gint *y1, gint *x2, gint *y2)
+{
+    *x1 = CLAMP((RECT_LEFT(*r) - bounds.x) / CELL_SIZE, 0, cols - 1);
+    *y1 = CLAMP((RECT_TOP(*r) - bounds.y) / CELL_SIZE, 0, rows - 1);
+    *x2 = CLAMP((RECT_RIGHT(*r) - bounds.x) / CELL_SIZE, *x1, cols - 1);
+    *y2 = CLAMP((RECT_BOTTOM(*r) - bounds.y) / CELL_SIZE, *y1, rows - 1);
+}
+
+static GSList** cell(guint grid, gint x, gint y)
+{
+    return &cells[(grid * rows + y) * cols + x];
+}
+
+static void entry_insert(ObSpatialEntry *e)
+{
+    gint x, y;
+
+    e->grid = client_grid(e->client);
+    cell_range(&e->area, &e->x1, &e->y1, &e->x2, &e->y2);
+    for (y = e->y1; y <= e->y2; ++y)
+        for (x = e->x1; x <= e->x2; ++x) {
+            GSList **l = cell(e->grid, x, y);
+            *l = g_slist_prepend(*l, e);
+        }
+}
+
+static void entry_unlink(ObSpatialEntry *e)
+{
+    gint x, y;
+
+    for (y = e->y1; y <= e->y2; ++y)
+        for (x = e->x1; x <= e->x2; ++x) {
+            GSList **l = cell(e->grid, x, y);
+            *l = g_slist_remove(*l, e);
+        }
+}
+
+static void entry_insert_func(gpointer key, gpointer val, gpointer data)
+{
+    entry_insert(val);
+}
+
+static void free_cells(void)
+{
+    guint i;
+
+    for (i = 0; i < num_grids * cols * rows; ++i)
+        g_slist_free(cells[i]);
+    g_free(cells);
+    cells = NULL;
+}
+
+static void entry_free(gpointer e)
+{
+    g_slice_free(ObSpatialEntry, e);
+}
+
+void spatial_shutdown(gboolean reconfig)
+{
+    if (reconfig) return;
+
+    if (cells) free_cells();
+    if (entries) g_hash_table_destroy(entries);
+    entries = NULL;
+}
+
+void spatial_resize(void)
+{
+    const Rect *a = screen_physical_area_all_monitors();
+
+    if (cells && RECT_EQUAL(*a, bounds) &&
+        num_grids == screen_num_desktops + 1)
+        return;
+
+    if (cells) free_cells();
+
+    bounds = *a;
+    num_grids = screen_num_desktops + 1;
+    cols = MAX(1, (bounds.width + CELL_SIZE - 1) / CELL_SIZE);
+    rows = MAX(1, (bounds.height + CELL_SIZE - 1) / CELL_SIZE);
+    cells = g_new0(GSList*, num_grids * cols * rows);
+
+    if (entries)
+        g_hash_table_foreach(entries, entry_insert_func, NULL);
+}
+
+void spatial_update(ObClient *c)
+{
+    ObSpatialEntry *e;
+
+    if (!entries)
+        entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        NULL, entry_free);
+
+    e = g_hash_table_lookup(entries, c);
+    if (!e) {
+        e = g_slice_new0(ObSpatialEntry);
+        e->client = c;
+        e->area = c->frame->area;
+        g_hash_table_insert(entries, c, e);
+    }
+    else if (RECT_EQUAL(e->area, c->frame->area) &&
+             (!cells || e->grid == client_grid(c)))
+        return; /* nothing changed */
+    else {
+        if (cells) entry_unlink(e);
+        e->area = c->frame->area;
+    }
+
+    if (cells) entry_insert(e);
+}
+
+void spatial_remove(ObClient *c)
+{
+    ObSpatialEntry *e;
+
+    if (entries && (e = g_hash_table_lookup(entries, c))) {
+        if (cells) entry_unlink(e);
+        g_hash_table_remove(entries, c);
+    }
+}
+
+static GSList* find_in_grid(GSList *list, guint grid, const Rect *r)
+{
+    gint x1, y1, x2, y2, x, y;
+    GSList *it;
+
+    cell_range(r, &x1, &y1, &x2, &y2);
+    for (y = y1; y <= y2; ++y)
+        for (x = x1; x <= x2; ++x)
+            for (it = *cell(grid, x, y); it; it = g_slist_next(it)) {
+                ObSpatialEntry *e = it->data;
+
+                if (e->found != search &&
+                    RECT_INTERSECTS_RECT(e->area, *r))
+                {
+                    e->found = search;
+                    list = g_slist_prepend(list, e->client);
+                }
+            }
+    return list;
+}
+
+GSList* spatial_find_rect(const Rect *r, guint desktop,
+                          gboolean all_desktops)
+{
+    GSList *list = NULL;
+
+    if (!cells || r->width <= 0 || r->height <= 0) return NULL;
+
+    ++search;
+    if (desktop < num_grids - 1)
+        list = find_in_grid(list, desktop, r);
+    if (all_desktops || desktop == DESKTOP_ALL)
+        list = find_in_grid(list, num_grids - 1, r);
+    return list;
+}
+
+GSList* spatial_find_point(gint x, gint y, guint desktop,
+                           gboolean all_desktops)
+{
+    Rect r;
+
+    RECT_SET(r, x, y, 1, 1);
+    return spatial_find_rect(&r, desktop, all_desktops);
+}
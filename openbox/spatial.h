@@ -0,0 +1,59 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   spatial.h for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __spatial_h
+#define __spatial_h
+
+#include "geom.h"
+
+#include <glib.h>
+
+struct _ObClient;
+
+/*! Keeps the frame area of every client in a grid of cells over the screen,
+  with a separate grid for each desktop and one for the clients on all
+  desktops.  Frames outside of the screen are kept in the cells along its
+  edge, so every client is found by a search which covers the screen.
+
+  The clients are in the grid whether they are shown or not, as placing and
+  edge searching look at desktops which are not being shown, so callers still
+  need to check things like frame->visible and iconic.
+*/
+void spatial_shutdown(gboolean reconfig);
+
+/*! Call when the size of the screen or the number of desktops changes, to
+  rebuild the grid */
+void spatial_resize(void);
+
+/*! Call when a client's frame area or its desktop changes */
+void spatial_update(struct _ObClient *c);
+/*! Call when a client is unmanaged */
+void spatial_remove(struct _ObClient *c);
+
+/*! Returns a list of the clients on the desktop whose frames intersect the
+  rectangle.  If @all_desktops is TRUE, then the clients on all desktops are
+  included.  The list is in no particular order, and should be freed with
+  g_slist_free(). */
+GSList* spatial_find_rect(const Rect *r, guint desktop,
+                          gboolean all_desktops);
+/*! Returns a list of the clients on the desktop whose frames contain the
+  point, like spatial_find_rect() */
+GSList* spatial_find_point(gint x, gint y, guint desktop,
+                           gboolean all_desktops);
+
+#endif
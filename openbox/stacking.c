@@ -28,42 +28,176 @@
 #include "debug.h"
 #include "dock.h"
 #include "config.h"
+#include "ipc.h"
+#include "publish.h"
 #include "obt/prop.h"
 
 GList  *stacking_list = NULL;
 GList  *stacking_list_tail = NULL;
+/*! The highest and lowest windows in each layer of the stacking_list, or NULL
+  when nothing is in the layer */
+static GList *layer_top[OB_NUM_STACKING_LAYERS];
+static GList *layer_bottom[OB_NUM_STACKING_LAYERS];
 /*! When true, stacking changes will not be reflected on the screen.  This is
   to freeze the on-screen stacking order while a window is being temporarily
   raised during focus cycling */
 static gboolean pause_changes = FALSE;
+/*! When true, the stacking_pos of the windows needs to be counted again */
+static gboolean positions_changed = TRUE;
 
-void stacking_set_list(void)
+/*! Returns the highest window in the layer, or the highest one below it */
+static GList* layer_find_top(ObStackingLayer l)
+{
+    gint i;
+
+    for (i = l; i > OB_STACKING_LAYER_INVALID; --i)
+        if (layer_top[i]) return layer_top[i];
+    return NULL;
+}
+
+/*! Returns the highest window below the layer */
+static GList* layer_find_below(ObStackingLayer l)
+{
+    return l > OB_STACKING_LAYER_INVALID ? layer_find_top(l - 1) : NULL;
+}
+
+static ObStackingLayer link_layer(GList *link)
+{
+    return ((ObWindow*)link->data)->stacking_layer;
+}
+
+/*! Takes the window out of the stacking_list */
+static void list_unlink(ObWindow *win)
+{
+    GList *link = win->stacking_link;
+    ObStackingLayer l = win->stacking_layer;
+
+    if (layer_top[l] == link)
+        layer_top[l] = (link->next && link_layer(link->next) == l) ?
+            link->next : NULL;
+    if (layer_bottom[l] == link)
+        layer_bottom[l] = (link->prev && link_layer(link->prev) == l) ?
+            link->prev : NULL;
+    if (stacking_list_tail == link)
+        stacking_list_tail = link->prev;
+
+    stacking_list = g_list_delete_link(stacking_list, link);
+    win->stacking_link = NULL;
+    positions_changed = TRUE;
+}
+
+/*! Puts the window into the stacking_list above @before, or at the bottom if
+  @before is NULL */
+static void list_insert_before(ObWindow *win, GList *before)
 {
-    Window *windows = NULL;
+    GList *link;
+    ObStackingLayer l;
+
+    if (before) {
+        stacking_list = g_list_insert_before(stacking_list, before, win);
+        link = before->prev;
+    }
+    else {
+        link = g_list_alloc();
+        link->data = win;
+        link->prev = stacking_list_tail;
+        link->next = NULL;
+        if (stacking_list_tail)
+            stacking_list_tail->next = link;
+        else
+            stacking_list = link;
+        stacking_list_tail = link;
+    }
+
+    l = window_layer(win);
+    win->stacking_link = link;
+    win->stacking_layer = l;
+    positions_changed = TRUE;
+
+    if (!layer_top[l])
+        layer_top[l] = layer_bottom[l] = link;
+    else if (link->next == layer_top[l])
+        layer_top[l] = link;
+    else if (link->prev == layer_bottom[l])
+        layer_bottom[l] = link;
+}
+
+void stacking_remove(ObWindow *win)
+{
+    if (win->stacking_link)
+        list_unlink(win);
+}
+
+gint stacking_compare(gconstpointer a, gconstpointer b)
+{
+    const ObWindow *wa = a, *wb = b;
+
+    if (wa->stacking_layer != wb->stacking_layer)
+        return wa->stacking_layer > wb->stacking_layer ? -1 : 1;
+
+    if (positions_changed) {
+        GList *it;
+        guint i = 0;
+
+        for (it = stacking_list; it; it = g_list_next(it))
+            ((ObWindow*)it->data)->stacking_pos = i++;
+        positions_changed = FALSE;
+    }
+    return wa->stacking_pos < wb->stacking_pos ? -1 :
+        (wa->stacking_pos > wb->stacking_pos ? 1 : 0);
+}
+
+gulong* stacking_windows(guint *n)
+{
+    gulong *windows = NULL;
     GList *it;
     guint i = 0;
 
-    /* on shutdown, don't update the properties, so that we can read it back
-       in on startup and re-stack the windows as they were before we shut down
-    */
-    if (ob_state() == OB_STATE_EXITING) return;
-
-    /* create an array of the window ids (from bottom to top,
-       reverse order!) */
     if (stacking_list) {
-        windows = g_new(Window, g_list_length(stacking_list));
-        for (it = g_list_last(stacking_list); it; it = g_list_previous(it)) {
+        windows = g_new(gulong, g_list_length(stacking_list));
+        for (it = stacking_list_tail; it; it = g_list_previous(it)) {
             if (WINDOW_IS_CLIENT(it->data))
                 windows[i++] = WINDOW_AS_CLIENT(it->data)->window;
         }
     }
+    *n = i;
+    return windows;
+}
 
-    OBT_PROP_SETA32(obt_root(ob_screen), NET_CLIENT_LIST_STACKING, WINDOW,
-                    (gulong*)windows, i);
+static void stacking_write_list(void)
+{
+    gulong *windows;
+    guint n;
+
+    /* on shutdown, don't update the properties, so that we can read it back
+       in on startup and re-stack the windows as they were before we shut down
+    */
+    if (ob_state() == OB_STATE_EXITING) return;
 
+    windows = stacking_windows(&n);
+    OBT_PROP_SETA32(obt_root(ob_screen), NET_CLIENT_LIST_STACKING, WINDOW,
+                    windows, n);
     g_free(windows);
 }
 
+void stacking_set_list(void)
+{
+    gulong *windows;
+    guint n;
+
+    if (ob_state() == OB_STATE_EXITING) return;
+
+    /* IPC subscribers hear about it right away, and the root window property
+       is written once at the end of the main loop iteration */
+    if (ipc_has_subscribers(OB_IPC_EVENT_STACKING)) {
+        windows = stacking_windows(&n);
+        ipc_stacking_changed(windows, n);
+        g_free(windows);
+    }
+
+    publish_later(stacking_write_list);
+}
+
 static void do_restack(GList *wins, GList *before)
 {
     GList *it;
@@ -89,7 +223,7 @@ static void do_restack(GList *wins, GList *before)
     if (before == stacking_list)
         win[0] = screen_support_win;
     else if (!before)
-        win[0] = window_top(g_list_last(stacking_list)->data);
+        win[0] = window_top(stacking_list_tail->data);
     else
         win[0] = window_top(g_list_previous(before)->data);
 
@@ -97,7 +231,7 @@ static void do_restack(GList *wins, GList *before)
         win[i] = window_top(it->data);
         g_assert(win[i] != None); /* better not call stacking shit before
                                      setting your top level window value */
-        stacking_list = g_list_insert_before(stacking_list, before, it->data);
+        list_insert_before(it->data, before);
     }
 
 #ifdef DEBUG
@@ -175,15 +309,10 @@ static void do_raise(GList *wins)
         layer[l] = g_list_append(layer[l], it->data);
     }
 
-    it = stacking_list;
     for (i = OB_NUM_STACKING_LAYERS - 1; i >= 0; --i) {
         if (layer[i]) {
-            for (; it; it = g_list_next(it)) {
-                /* look for the top of the layer */
-                if (window_layer(it->data) <= (ObStackingLayer) i)
-                    break;
-            }
-            do_restack(layer[i], it);
+            /* go to the top of the layer */
+            do_restack(layer[i], layer_find_top(i));
             g_list_free(layer[i]);
         }
     }
@@ -202,15 +331,10 @@ static void do_lower(GList *wins)
         layer[l] = g_list_append(layer[l], it->data);
     }
 
-    it = stacking_list;
     for (i = OB_NUM_STACKING_LAYERS - 1; i >= 0; --i) {
         if (layer[i]) {
-            for (; it; it = g_list_next(it)) {
-                /* look for the top of the next layer down */
-                if (window_layer(it->data) < (ObStackingLayer) i)
-                    break;
-            }
-            do_restack(layer[i], it);
+            /* go to the top of the next layer down */
+            do_restack(layer[i], layer_find_below(i));
             g_list_free(layer[i]);
         }
     }
@@ -218,7 +342,7 @@ static void do_lower(GList *wins)
 
 static void restack_windows(ObClient *selected, gboolean raise)
 {
-    GList *it, *last, *below, *above, *next;
+    GList *it, *below, *above, *next;
     GList *wins = NULL;
 
     GList *group_helpers = NULL;
@@ -237,14 +361,17 @@ static void restack_windows(ObClient *selected, gboolean raise)
     }
 
     /* remove first so we can't run into ourself */
-    it = g_list_find(stacking_list, selected);
-    g_assert(it);
-    stacking_list = g_list_delete_link(stacking_list, it);
+    g_assert(CLIENT_AS_WINDOW(selected)->stacking_link);
+    list_unlink(CLIENT_AS_WINDOW(selected));
 
-    /* go from the bottom of the stacking list up. don't move any other windows
-       when lowering, we call this for each window independently */
-    if (raise) {
-        for (it = g_list_last(stacking_list); it; it = next) {
+    /* go from the bottom of the selected window's layer up. don't move any
+       other windows when lowering, we call this for each window
+       independently.  only transients can stay above the window, so there's
+       nothing to look for without any */
+    if (raise && selected->transients && layer_top[selected->layer]) {
+        GList *stop = layer_top[selected->layer]->prev;
+
+        for (it = layer_bottom[selected->layer]; it != stop; it = next) {
             next = g_list_previous(it);
 
             if (WINDOW_IS_CLIENT(it->data)) {
@@ -275,7 +402,7 @@ static void restack_windows(ObClient *selected, gboolean raise)
                         else
                             group_trans = g_list_prepend(group_trans, ch);
                     }
-                    stacking_list = g_list_delete_link(stacking_list, it);
+                    list_unlink(CLIENT_AS_WINDOW(ch));
                 }
             }
         }
@@ -301,33 +428,17 @@ static void restack_windows(ObClient *selected, gboolean raise)
         group_trans = NULL;
     }
 
-    /* find where to put the selected window, start from bottom of list,
-       this is the window below everything we are re-adding to the list */
-    last = NULL;
-    for (it = g_list_last(stacking_list); it; it = g_list_previous(it))
-    {
-        if (window_layer(it->data) < selected->layer) {
-            last = it;
-            continue;
-        }
-        /* if lowering, stop at the beginning of the layer */
-        if (!raise)
-            break;
-        /* if raising, stop at the end of the layer */
-        if (window_layer(it->data) > selected->layer)
-            break;
-
-        last = it;
-    }
-
-    /* save this position in the stacking list */
-    below = last;
+    /* find where to put the selected window, this is the window below
+       everything we are re-adding to the list.  when raising it's the top of
+       the layer, and when lowering it's the top of the layer below */
+    if (raise)
+        below = layer_find_top(selected->layer);
+    else
+        below = layer_find_below(selected->layer);
 
-    /* find where to put the group transients, start from the top of list */
-    for (it = stacking_list; it; it = g_list_next(it)) {
-        /* skip past higher layers */
-        if (window_layer(it->data) > selected->layer)
-            continue;
+    /* find where to put the group transients, start from the top of the
+       layer */
+    for (it = layer_find_top(selected->layer); it; it = g_list_next(it)) {
         /* if we reach the end of the layer (how?) then don't go further */
         if (window_layer(it->data) < selected->layer)
             break;
@@ -350,17 +461,17 @@ static void restack_windows(ObClient *selected, gboolean raise)
        we actually want to save 1 position _above_ that, for for loops to work
        nicely, so move back one position in the list while saving it
     */
-    above = it ? g_list_previous(it) : g_list_last(stacking_list);
+    above = it ? g_list_previous(it) : stacking_list_tail;
 
     /* put the windows inside the gap to the other windows we're stacking
        into the restacking list, go from the bottom up so that we can use
        g_list_prepend */
     if (below) it = g_list_previous(below);
-    else       it = g_list_last(stacking_list);
+    else       it = stacking_list_tail;
     for (; it != above; it = next) {
         next = g_list_previous(it);
         wins = g_list_prepend(wins, it->data);
-        stacking_list = g_list_delete_link(stacking_list, it);
+        list_unlink(it->data);
     }
 
     /* group transients go above the rest of the stuff acquired to now */
@@ -379,7 +490,7 @@ static void restack_windows(ObClient *selected, gboolean raise)
         parents_copy = g_slist_copy(selected->parents);
 
         /* go thru stacking list backwards so we can use g_slist_prepend */
-        for (it = g_list_last(stacking_list); it && parents_copy;
+        for (it = stacking_list_tail; it && parents_copy;
              it = g_list_previous(it))
             if ((sit = g_slist_find(parents_copy, it->data))) {
                 reorder = g_slist_prepend(reorder, sit->data);
@@ -402,11 +513,10 @@ void stacking_raise(ObWindow *window)
     } else {
         GList *wins;
         wins = g_list_append(NULL, window);
-        stacking_list = g_list_remove(stacking_list, window);
+        stacking_remove(window);
         do_raise(wins);
         g_list_free(wins);
     }
-    stacking_list_tail = g_list_last(stacking_list);
 }
 
 void stacking_lower(ObWindow *window)
@@ -418,11 +528,10 @@ void stacking_lower(ObWindow *window)
     } else {
         GList *wins;
         wins = g_list_append(NULL, window);
-        stacking_list = g_list_remove(stacking_list, window);
+        stacking_remove(window);
         do_lower(wins);
         g_list_free(wins);
     }
-    stacking_list_tail = g_list_last(stacking_list);
 }
 
 void stacking_below(ObWindow *window, ObWindow *below)
@@ -433,11 +542,10 @@ void stacking_below(ObWindow *window, ObWindow *below)
         return;
 
     wins = g_list_append(NULL, window);
-    stacking_list = g_list_remove(stacking_list, window);
-    before = g_list_next(g_list_find(stacking_list, below));
+    stacking_remove(window);
+    before = g_list_next(below->stacking_link);
     do_restack(wins, before);
     g_list_free(wins);
-    stacking_list_tail = g_list_last(stacking_list);
 }
 
 void stacking_add(ObWindow *win)
@@ -447,10 +555,9 @@ void stacking_add(ObWindow *win)
     /* don't add windows that are being unmanaged ! */
     if (WINDOW_IS_CLIENT(win)) g_assert(WINDOW_AS_CLIENT(win)->managed);
 
-    stacking_list = g_list_append(stacking_list, win);
+    list_insert_before(win, NULL);
 
     stacking_raise(win);
-    /* stacking_list_tail set by stacking_raise() */
 }
 
 static GList *find_highest_relative(ObClient *client)
@@ -464,8 +571,11 @@ static GList *find_highest_relative(ObClient *client)
         /* get all top level relatives of this client */
         top = client_search_all_top_parents_layer(client);
 
-        /* go from the top of the stacking order down */
-        for (it = stacking_list; !ret && it; it = g_list_next(it)) {
+        /* go from the top of the layer down */
+        for (it = layer_top[client->layer];
+             !ret && it && link_layer(it) == client->layer;
+             it = g_list_next(it))
+        {
             if (WINDOW_IS_CLIENT(it->data)) {
                 ObClient *c = it->data;
                 /* only look at windows in the same layer and that are
@@ -520,7 +630,7 @@ void stacking_add_nonintrusive(ObWindow *win)
         if (focus_client && client != focus_client &&
             focus_client->layer == client->layer)
         {
-            it_below = g_list_find(stacking_list, focus_client);
+            it_below = CLIENT_AS_WINDOW(focus_client)->stacking_link;
             /* this can give NULL, but it means the focused window is on the
                bottom of the stacking order, so go to the bottom in that case,
                below it */
@@ -544,26 +654,18 @@ void stacking_add_nonintrusive(ObWindow *win)
         }
     }
 
-    /* make sure it's not in the wrong layer though ! */
-    for (; it_below; it_below = g_list_next(it_below)) {
-        /* stop when the window is not in a higher layer than the window
-           it is going above (it_below) */
-        if (client->layer >= window_layer(it_below->data))
-            break;
-    }
-    for (; it_below != stacking_list; it_below = it_above) {
-        /* stop when the window is not in a lower layer than the
-           window it is going under (it_above) */
-        it_above = it_below ?
-            g_list_previous(it_below) : g_list_last(stacking_list);
-        if (client->layer <= window_layer(it_above->data))
-            break;
-    }
+    /* make sure it's not in the wrong layer though !  it can't go above a
+       window in a higher layer (it_below) */
+    if (it_below && client->layer < window_layer(it_below->data))
+        it_below = layer_find_top(client->layer);
+    /* and it can't go under a window in a lower layer (it_above) */
+    it_above = it_below ? g_list_previous(it_below) : stacking_list_tail;
+    if (it_above && client->layer > window_layer(it_above->data))
+        it_below = layer_find_below(client->layer);
 
     wins = g_list_append(NULL, win);
     do_restack(wins, it_below);
     g_list_free(wins);
-    stacking_list_tail = g_list_last(stacking_list);
 }
 
 /*! Returns TRUE if client is occluded by the sibling. If sibling is NULL it
@@ -582,7 +684,7 @@ static gboolean stacking_occluded(ObClient *client, ObWindow *sibling_win)
     if (sibling && client->layer != sibling->layer)
         return FALSE;
 
-    for (it = g_list_previous(g_list_find(stacking_list, client)); it;
+    for (it = g_list_previous(CLIENT_AS_WINDOW(client)->stacking_link); it;
          it = g_list_previous(it))
         if (WINDOW_IS_CLIENT(it->data)) {
             ObClient *c = it->data;
@@ -642,7 +744,7 @@ static gboolean stacking_occludes(ObClient *client, ObWindow *sibling_win)
     if (sibling && client->layer != sibling->layer)
         return FALSE;
 
-    for (it = g_list_next(g_list_find(stacking_list, client));
+    for (it = g_list_next(CLIENT_AS_WINDOW(client)->stacking_link);
          it; it = g_list_next(it))
         if (WINDOW_IS_CLIENT(it->data)) {
             ObClient *c = it->data;
@@ -38,18 +38,29 @@ typedef enum {
     OB_NUM_STACKING_LAYERS
 } ObStackingLayer;
 
-/* list of ObWindow*s in stacking order from highest to lowest */
+/* list of ObWindow*s in stacking order from highest to lowest.  The windows
+   in each layer are together, and each ObWindow keeps its own link into the
+   list, so it is never searched for them. */
 extern GList *stacking_list;
-/* list of ObWindow*s in stacking order from lowest to highest */
+/* the last link in the stacking_list, the lowest window */
 extern GList *stacking_list_tail;
 
 /*! Sets the window stacking list on the root window from the
   stacking_list */
 void stacking_set_list(void);
+/*! Returns the client windows from bottom to top, the reverse of the
+  stacking_list.  Free it with g_free() */
+gulong* stacking_windows(guint *n);
 
 void stacking_add(struct _ObWindow *win);
 void stacking_add_nonintrusive(struct _ObWindow *win);
-#define stacking_remove(win) stacking_list = g_list_remove(stacking_list, win);
+void stacking_remove(struct _ObWindow *win);
+
+/*! A GCompareFunc for ObWindows in the stacking_list, which sorts the
+  highest window first.  The windows' positions are counted again after the
+  stacking_list changes, so sorting a few windows is cheap while they are not
+  being restacked. */
+gint stacking_compare(gconstpointer a, gconstpointer b);
 
 /*! Raises a window above all others in its stacking layer */
 void stacking_raise(struct _ObWindow *window);
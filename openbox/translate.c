@@ -109,6 +109,7 @@ gboolean translate_key(const gchar *str, guint *state, guint *keycode)
     gint i;
     gboolean ret = FALSE;
     KeySym sym;
+    KeyCode *keycodes;
 
     parsed = g_strsplit(str, "-", -1);
 
@@ -145,7 +146,9 @@ gboolean translate_key(const gchar *str, guint *state, guint *keycode)
             g_message(_("Invalid key name \"%s\" in key binding"), l);
             goto translation_fail;
         }
-        *keycode = XKeysymToKeycode(obt_display, sym);
+        keycodes = obt_keyboard_keysym_to_keycode(sym);
+        *keycode = keycodes[0];
+        g_free(keycodes);
     }
     if (!*keycode) {
         g_message(_("Requested key \"%s\" does not exist on the display"), l);
@@ -39,6 +39,14 @@ typedef enum {
    struct */
 struct _ObWindow {
     ObWindowClass type;
+    /*! The window's place in the stacking_list, or NULL when it is not in
+      the list */
+    GList *stacking_link;
+    /*! The layer it was put in the stacking_list with */
+    ObStackingLayer stacking_layer;
+    /*! Its position in the stacking_list counting from the top, which is only
+      kept up to date by stacking_compare() */
+    guint stacking_pos;
 };
 
 #define WINDOW_IS_MENUFRAME(win) \
@@ -82,7 +90,7 @@ void      window_remove(Window xwin);
 
 /* Internal openbox-owned windows like the alt-tab popup */
 struct _ObInternalWindow {
-    ObWindowClass type;
+    ObWindow obwin;
     Window window;
 };
 
@@ -0,0 +1,134 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   xdg-autostart.c for the Openbox window manager
+   Copyright (c) 2010        Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "obt/autostart.h"
+#include "obt/paths.h"
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ME "openbox-xdg-autostart"
+
+/*! How long to wait for the Initialization phase with --ordered */
+#define INIT_TIMEOUT 5000
+
+static void show_help(void)
+{
+    printf("Usage: %s [OPTION]... [ENVIRONMENT]...\n\n"
+           "This tool will run xdg autostart .desktop files\n\n"
+           "OPTIONS\n"
+           "  --list        Show a list of the files which would be run\n"
+           "                Files which would be run are marked with an asterix\n"
+           "                symbol [*].  For files which would not be run,\n"
+           "                information is given for why they are excluded\n"
+           "  --ordered     Wait for the commands in the Initialization phase\n"
+           "                to exit before starting the others\n"
+           "  --help        Show this help and exit\n"
+           "  --version     Show version and copyright information\n\n"
+           "ENVIRONMENT specifies a list of environments for which to run autostart\n"
+           "applications.  If none are specified, only applications which do not \n"
+           "limit themselves to certain environments will be run.\n\n"
+           "ENVIRONMENT can be one or more of:\n"
+           "  OPENBOX       Openbox\n"
+           "  GNOME         Gnome Desktop\n"
+           "  KDE           KDE Desktop\n"
+           "  LXDE          LXDE Desktop\n"
+           "  ROX           ROX Desktop\n"
+           "  XFCE          XFCE Desktop\n"
+           "  Old           Legacy systems\n\n", ME);
+}
+
+static void show_version(void)
+{
+    printf("%s %s\n"
+           "Copyright (c) 2008        Dana Jansens\n\n", ME, PACKAGE_VERSION);
+}
+
+static void show_list(GSList *entries)
+{
+    GSList *it;
+
+    for (it = entries; it; it = g_slist_next(it)) {
+        ObtAutostartEntry *e = it->data;
+
+        printf("[%c] %s\n", e->status == OBT_AUTOSTART_RUN ? '*' : ' ',
+               e->name);
+        printf("\t  File: %s\n", e->path);
+        if (e->exec)
+            printf("\t  Executes: %s\n", e->exec);
+        if (e->status != OBT_AUTOSTART_RUN)
+            printf("\t* %s\n", obt_autostart_status_string(e->status));
+        printf("\n");
+    }
+}
+
+static void show_started(GSList *entries)
+{
+    GSList *it;
+
+    for (it = entries; it; it = g_slist_next(it)) {
+        ObtAutostartEntry *e = it->data;
+
+        if (e->started >= 0)
+            fprintf(stderr, "%s: %7.3fs %s (%s)\n",
+                    ME, e->started, e->name, e->path);
+    }
+}
+
+gint main(gint argc, gchar **argv)
+{
+    ObtPaths *paths;
+    GSList *entries;
+    GPtrArray *envs;
+    gboolean list = FALSE, ordered = FALSE;
+    gint i;
+
+    envs = g_ptr_array_new();
+    for (i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--help")) {
+            show_help();
+            return 0;
+        }
+        else if (!strcmp(argv[i], "--version")) {
+            show_version();
+            return 0;
+        }
+        else if (!strcmp(argv[i], "--list"))
+            list = TRUE;
+        else if (!strcmp(argv[i], "--ordered"))
+            ordered = TRUE;
+        else
+            g_ptr_array_add(envs, argv[i]);
+    }
+    g_ptr_array_add(envs, NULL);
+
+    paths = obt_paths_new();
+    entries = obt_autostart_entries(paths, (gchar**)envs->pdata);
+
+    if (list)
+        show_list(entries);
+    else {
+        obt_autostart_run(entries, ordered, INIT_TIMEOUT);
+        show_started(entries);
+    }
+
+    obt_autostart_entries_free(entries);
+    obt_paths_unref(paths);
+    g_ptr_array_free(envs, TRUE);
+    return 0;
+}